@@ -0,0 +1,949 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_BTree.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Ordered B+tree index stored in FRAM with a redo journal.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_BTree.h"
+#include "FRAM_Image.h"
+
+#define FRAM_BTREE_LEAF 1
+#define FRAM_BTREE_JOURNAL_IDLE 0
+#define FRAM_BTREE_JOURNAL_COMMITTED 1
+
+static uint32_t getLong(const uint8_t *p)
+{
+	return p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t getWord(const uint8_t *p)
+{
+	return p[0] | ((uint16_t) p[1] << 8);
+}
+
+static void putLong(uint8_t *p, uint32_t value)
+{
+	for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t) (value >> (8 * i));
+}
+
+static void putWord(uint8_t *p, uint16_t value)
+{
+	p[0] = (uint8_t) value;
+	p[1] = (uint8_t) (value >> 8);
+}
+
+#define ENTRY(node, i) ((node) + 4 + (uint16_t) (i) * FRAM_BTREE_ENTRY_SIZE)
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	The area holds the header, the journal and the nodes, see FRAM_BTree.h
+*/
+/**************************************************************************/
+FRAM_BTree::FRAM_BTree(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		if (size > (FRAM_BTREE_HEADER_SIZE + FRAM_BTREE_JOURNAL_SIZE)) {
+			_nodesMax = (size - FRAM_BTREE_HEADER_SIZE - FRAM_BTREE_JOURNAL_SIZE) / FRAM_BTREE_NODE_SIZE;
+		}
+		else {
+			_nodesMax = 0;
+		}
+		_root = 0;
+		_height = 0;
+		_nodesUsed = 0;
+		_entries = 0;
+		_journalCount = 0;
+		_journalCrc = 0;
+		for (uint8_t i = 0; i < FRAM_BTREE_CACHE_NODES; i++) _cacheIndex[i] = FRAM_BTREE_NONE;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Creates an empty tree, the previous content of the area is lost
+
+    @returns
+					0: success
+					11: area out of the memory map
+					16: area too small for the journal and 3 nodes
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::format(void)
+{
+	if (_nodesMax < 3) return ERROR_16;
+	byte result = FRAM_BTree::checkLayout();
+	if (result != ERROR_0) return result;
+
+	result = _fram->writeByte(_framAddr + FRAM_BTREE_HEADER_SIZE, FRAM_BTREE_JOURNAL_IDLE);
+	if (result != ERROR_0) return result;
+
+	memset(_node, 0, FRAM_BTREE_NODE_SIZE);
+	_node[0] = FRAM_BTREE_LEAF;
+	putWord(_node + 2, FRAM_BTREE_NONE);
+	result = _fram->writeBlock(FRAM_BTree::nodeAddr(0), FRAM_BTREE_NODE_SIZE, _node);
+	if (result != ERROR_0) return result;
+
+	_root = 0;
+	_height = 1;
+	_nodesUsed = 1;
+	_entries = 0;
+	for (uint8_t i = 0; i < FRAM_BTREE_CACHE_NODES; i++) _cacheIndex[i] = FRAM_BTREE_NONE;
+	FRAM_BTree::headerImage(_split);
+	return _fram->writeBlock(_framAddr, FRAM_BTREE_HEADER_SIZE, _split);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens an existing tree. A modification interrupted by a power
+				loss is completed from the journal if it had been committed,
+				dropped otherwise.
+
+    @returns
+					0: success
+					11: area out of the memory map
+					12: not a tree or journal corrupted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::begin(void)
+{
+	for (uint8_t i = 0; i < FRAM_BTREE_CACHE_NODES; i++) _cacheIndex[i] = FRAM_BTREE_NONE;
+	byte result = FRAM_BTree::checkLayout();
+	if (result != ERROR_0) return result;
+	result = FRAM_BTree::journalRecover();
+	if (result != ERROR_0) return result;
+	return FRAM_BTree::loadHeader();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the tree and opens it, may replace begin(). After the
+				journal and the header, the nodes reachable from the root are
+				read depth first, one burst per node: node types and entry
+				counts, keys in order and within the separators of the parents,
+				leaf chain in key order, no node left unreachable, entry count.
+				Leaves are read aside, an internal node is read again after
+				each internal child, from the level cache for the upper
+				FRAM_BTREE_CACHE_NODES levels and with one more burst below.
+				With repair, a committed journal is applied, or dropped when
+				its CRC32 is wrong, and a wrong entry count is rewritten.
+				Without repair, the nodes are checked as they are.
+
+    @params[out] *report
+                Inconsistencies found, see FRAM_Fsck
+    @params[in] repair
+                true to repair what can be
+    @returns
+					0: tree consistent, or repaired
+					11: area out of the memory map
+					12: inconsistencies left, see report
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::check(FRAM_FsckReport *report, boolean repair)
+{
+	uint16_t journal = _framAddr + FRAM_BTREE_HEADER_SIZE;
+	uint8_t record[6];
+	boolean valid;
+	uint16_t left = 0;
+
+	for (uint8_t i = 0; i < FRAM_BTREE_CACHE_NODES; i++) _cacheIndex[i] = FRAM_BTREE_NONE;
+	byte result = FRAM_BTree::checkLayout();
+	if (result != ERROR_0) return result;
+	result = FRAM_BTree::journalCheck(record, &valid);
+	if (result != ERROR_0) return result;
+	if (record[0] != FRAM_BTREE_JOURNAL_IDLE) {
+		if (repair) {
+			if (valid) {
+				_journalCount = record[1];
+				result = FRAM_BTree::journalApply();
+			}
+			if (result == ERROR_0) result = _fram->writeByte(journal, FRAM_BTREE_JOURNAL_IDLE);
+			if (result != ERROR_0) return result;
+		}
+		else {
+			left++;
+		}
+		FRAM_Fsck::problem(report, journal, FRAM_FSCK_JOURNAL, repair);
+	}
+
+	result = FRAM_BTree::loadHeader();
+	if (result == ERROR_12) {
+		FRAM_Fsck::problem(report, _framAddr, FRAM_FSCK_HEADER, false);
+		return ERROR_12;
+	}
+	if (result != ERROR_0) return result;
+
+	// depth first walk: the internal node of the current level stays in
+	// _node while its leaves are read into _split
+	uint16_t index[FRAM_BTREE_MAX_HEIGHT];
+	uint8_t pos[FRAM_BTREE_MAX_HEIGHT];
+	uint32_t low[FRAM_BTREE_MAX_HEIGHT];
+	uint64_t high[FRAM_BTREE_MAX_HEIGHT];
+	uint16_t visited = 0;
+	uint16_t loaded = FRAM_BTREE_NONE;
+	uint16_t next = FRAM_BTREE_NONE;
+	uint16_t child;
+	uint32_t entries = 0;
+	uint8_t level = 0;
+	uint8_t fault, count, p;
+	boolean enter = true;
+	boolean chained = false;
+	boolean damaged = false;
+	boolean leaf;
+	uint8_t *node;
+
+	index[0] = _root;
+	low[0] = 0;
+	high[0] = 0x100000000ULL;
+	while (true) {
+		if (enter) {
+			enter = false;
+			if (++visited > _nodesUsed) {
+				// a node reached twice: shared child or cycle
+				FRAM_Fsck::problem(report, FRAM_BTree::nodeAddr(index[level]), FRAM_FSCK_LINK, false);
+				damaged = true;
+				break;
+			}
+			leaf = (level == (_height - 1));
+			node = leaf ? _split : _node;
+			result = _fram->readBlock(FRAM_BTree::nodeAddr(index[level]), FRAM_BTREE_NODE_SIZE, node);
+			if (result != ERROR_0) return result;
+			if (!leaf) loaded = index[level];
+
+			fault = FRAM_BTree::checkNode(node, leaf, low[level], high[level]);
+			if (fault != 0) {
+				FRAM_Fsck::problem(report, FRAM_BTree::nodeAddr(index[level]), fault, false);
+				damaged = true;
+			}
+			if ((fault != FRAM_FSCK_NODE) && leaf) {
+				if (chained && (next != index[level])) {
+					FRAM_Fsck::problem(report, FRAM_BTree::nodeAddr(index[level]), FRAM_FSCK_LINK, false);
+					damaged = true;
+				}
+				next = getWord(node + 2);
+				chained = true;
+				entries += node[1];
+			}
+			if ((fault == FRAM_FSCK_NODE) || leaf) {
+				if (level == 0) break;
+				level--;
+			}
+			else {
+				pos[level] = 0;
+			}
+			continue;
+		}
+
+		if (loaded != index[level]) {
+			result = FRAM_BTree::readNode(index[level], level, _node);
+			if (result != ERROR_0) return result;
+			loaded = index[level];
+		}
+		count = _node[1];
+		if (pos[level] > count) {
+			if (level == 0) break;
+			level--;
+			continue;
+		}
+		p = pos[level]++;
+		child = (p == 0) ? getWord(_node + 2) : getWord(ENTRY(_node, p - 1) + 4);
+		if (child >= _nodesUsed) {
+			FRAM_Fsck::problem(report, FRAM_BTree::nodeAddr(index[level]), FRAM_FSCK_LINK, false);
+			damaged = true;
+			continue;
+		}
+		low[level + 1] = (p == 0) ? low[level] : getLong(ENTRY(_node, p - 1));
+		high[level + 1] = (p == count) ? high[level] : getLong(ENTRY(_node, p));
+		index[level + 1] = child;
+		level++;
+		enter = true;
+	}
+
+	if (!damaged && (next != FRAM_BTREE_NONE)) {
+		FRAM_Fsck::problem(report, _framAddr, FRAM_FSCK_LINK, false);
+		damaged = true;
+	}
+	if (damaged) return ERROR_12;
+
+	if (visited < _nodesUsed) {
+		FRAM_Fsck::problem(report, _framAddr, FRAM_FSCK_LEAK, false);
+		left++;
+	}
+	if (entries != _entries) {
+		if (repair) {
+			_entries = entries;
+			FRAM_BTree::headerImage(_split);
+			result = _fram->writeBlock(_framAddr, FRAM_BTREE_HEADER_SIZE, _split);
+			if (result != ERROR_0) return result;
+		}
+		else {
+			left++;
+		}
+		FRAM_Fsck::problem(report, _framAddr, FRAM_FSCK_COUNT, repair);
+	}
+	return (left == 0) ? ERROR_0 : ERROR_12;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Finds the value of a key, one burst read per level below the
+				cached nodes
+
+    @params[in] key
+                The key to find
+    @params[out] *value
+                The value stored with the key
+    @returns
+					0: success
+					15: key not found
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::lookup(uint32_t key, uint16_t *value)
+{
+	uint16_t path[FRAM_BTREE_MAX_HEIGHT];
+	uint16_t leaf;
+	byte result = FRAM_BTree::findLeaf(key, path, &leaf);
+	if (result != ERROR_0) return result;
+
+	uint8_t pos = FRAM_BTree::lowerBound(_node, key);
+	if ((pos >= _node[1]) || (getLong(ENTRY(_node, pos)) != key)) return ERROR_15;
+	*value = getWord(ENTRY(_node, pos) + 4);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Inserts a key or replaces its value. Full nodes are split up to
+				the root, all modified nodes are journaled and applied once
+				committed.
+
+    @params[in] key
+                The key to insert
+    @params[in] value
+                The value stored with the key
+    @returns
+					0: success
+					16: no free node left for the splits
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::insert(uint32_t key, uint16_t value)
+{
+	uint16_t path[FRAM_BTREE_MAX_HEIGHT];
+	uint16_t index;
+	byte result = FRAM_BTree::findLeaf(key, path, &index);
+	if (result != ERROR_0) return result;
+
+	uint8_t pos = FRAM_BTree::lowerBound(_node, key);
+	FRAM_BTree::journalBegin();
+	if ((pos < _node[1]) && (getLong(ENTRY(_node, pos)) == key)) {
+		putWord(ENTRY(_node, pos) + 4, value);
+		result = FRAM_BTree::journalAdd(index, _node);
+		if (result != ERROR_0) return result;
+		return FRAM_BTree::journalCommit();
+	}
+
+	// worst case: one new node per level and a new root
+	if (((uint32_t) _nodesUsed + _height + 1) > _nodesMax) return ERROR_16;
+
+	uint16_t root = _root;
+	uint8_t height = _height;
+	uint16_t nodesUsed = _nodesUsed;
+	uint8_t level = _height - 1;
+	uint16_t right;
+	uint8_t count, left;
+	uint32_t separator;
+
+	FRAM_BTree::insertEntry(_node, pos, key, value);
+	while (true) {
+		count = _node[1];
+		if (count <= FRAM_BTREE_CAPACITY) {
+			result = FRAM_BTree::journalAdd(index, _node);
+			break;
+		}
+
+		// split: the upper half moves to a new right sibling
+		right = nodesUsed++;
+		left = (count + 1) / 2;
+		memset(_split, 0, FRAM_BTREE_NODE_SIZE);
+		_split[0] = _node[0];
+		if (_node[0] == FRAM_BTREE_LEAF) {
+			_split[1] = count - left;
+			memcpy(_split + 2, _node + 2, 2);
+			memcpy(ENTRY(_split, 0), ENTRY(_node, left), (uint16_t) (count - left) * FRAM_BTREE_ENTRY_SIZE);
+			putWord(_node + 2, right);
+			separator = getLong(ENTRY(_split, 0));
+		}
+		else {
+			// the middle key moves up, its child becomes the first child of the right node
+			_split[1] = count - left - 1;
+			memcpy(_split + 2, ENTRY(_node, left) + 4, 2);
+			memcpy(ENTRY(_split, 0), ENTRY(_node, left + 1), (uint16_t) (count - left - 1) * FRAM_BTREE_ENTRY_SIZE);
+			separator = getLong(ENTRY(_node, left));
+		}
+		_node[1] = left;
+		memset(ENTRY(_node, left), 0, FRAM_BTREE_NODE_SIZE + FRAM_BTREE_ENTRY_SIZE - (4 + (uint16_t) left * FRAM_BTREE_ENTRY_SIZE));
+
+		result = FRAM_BTree::journalAdd(index, _node);
+		if (result == ERROR_0) result = FRAM_BTree::journalAdd(right, _split);
+		if (result != ERROR_0) break;
+
+		if (level == 0) {
+			// root split, the tree grows by one level. Nothing is committed yet.
+			if (height == FRAM_BTREE_MAX_HEIGHT) return ERROR_16;
+			memset(_node, 0, FRAM_BTREE_NODE_SIZE);
+			putWord(_node + 2, index);
+			FRAM_BTree::insertEntry(_node, 0, separator, right);
+			root = nodesUsed++;
+			height++;
+			result = FRAM_BTree::journalAdd(root, _node);
+			break;
+		}
+
+		level--;
+		index = path[level];
+		result = FRAM_BTree::readNode(index, level, _node);
+		if (result != ERROR_0) break;
+		FRAM_BTree::insertEntry(_node, FRAM_BTree::lowerBound(_node, separator), separator, right);
+	}
+	if (result != ERROR_0) return result;
+
+	uint16_t oldRoot = _root;
+	uint8_t oldHeight = _height;
+	uint16_t oldNodesUsed = _nodesUsed;
+	_root = root;
+	_height = height;
+	_nodesUsed = nodesUsed;
+	_entries++;
+	FRAM_BTree::headerImage(_split);
+	result = FRAM_BTree::journalAdd(FRAM_BTREE_NONE, _split);
+	if (result == ERROR_0) result = FRAM_BTree::journalCommit();
+	if (result != ERROR_0) {
+		// the chip may hold either version, it is known again after begin()
+		_root = oldRoot;
+		_height = oldHeight;
+		_nodesUsed = oldNodesUsed;
+		_entries--;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Removes a key. Leaves are not merged: a leaf left empty stays
+				linked and is skipped by the scans.
+
+    @params[in] key
+                The key to remove
+    @returns
+					0: success
+					15: key not found
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::remove(uint32_t key)
+{
+	uint16_t path[FRAM_BTREE_MAX_HEIGHT];
+	uint16_t index;
+	byte result = FRAM_BTree::findLeaf(key, path, &index);
+	if (result != ERROR_0) return result;
+
+	uint8_t pos = FRAM_BTree::lowerBound(_node, key);
+	uint8_t count = _node[1];
+	if ((pos >= count) || (getLong(ENTRY(_node, pos)) != key)) return ERROR_15;
+
+	memmove(ENTRY(_node, pos), ENTRY(_node, pos + 1), (uint16_t) (count - pos - 1) * FRAM_BTREE_ENTRY_SIZE);
+	memset(ENTRY(_node, count - 1), 0, FRAM_BTREE_ENTRY_SIZE);
+	_node[1] = count - 1;
+
+	FRAM_BTree::journalBegin();
+	result = FRAM_BTree::journalAdd(index, _node);
+	if (result != ERROR_0) return result;
+	_entries--;
+	FRAM_BTree::headerImage(_split);
+	result = FRAM_BTree::journalAdd(FRAM_BTREE_NONE, _split);
+	if (result == ERROR_0) result = FRAM_BTree::journalCommit();
+	if (result != ERROR_0) _entries++;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Visits the keys of a range in ascending order, following the
+				linked leaves with one burst read per leaf
+
+    @params[in] from
+                The lowest key of the range
+    @params[in] to
+                The highest key of the range, included
+    @params[in] visitor
+                Called for each key, returns false to stop the scan
+    @params[in] context
+                Passed to the visitor
+    @returns
+					0: success
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::scan(uint32_t from, uint32_t to, FRAM_BTreeVisitor visitor, void *context)
+{
+	uint16_t path[FRAM_BTREE_MAX_HEIGHT];
+	uint16_t index;
+	uint32_t key;
+	byte result = FRAM_BTree::findLeaf(from, path, &index);
+	if (result != ERROR_0) return result;
+	uint8_t pos = FRAM_BTree::lowerBound(_node, from);
+
+	while (result == ERROR_0) {
+		for (; pos < _node[1]; pos++) {
+			key = getLong(ENTRY(_node, pos));
+			if (key > to) return ERROR_0;
+			if (!visitor(key, getWord(ENTRY(_node, pos) + 4), context)) return ERROR_0;
+		}
+		index = getWord(_node + 2);
+		if (index == FRAM_BTREE_NONE) break;
+		result = FRAM_BTree::readNode(index, FRAM_BTREE_MAX_HEIGHT, _node);
+		pos = 0;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of keys stored
+*/
+/**************************************************************************/
+uint32_t FRAM_BTree::getEntries(void)
+{
+	return _entries;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of levels, 1 when the root is a leaf
+*/
+/**************************************************************************/
+uint8_t FRAM_BTree::getHeight(void)
+{
+	return _height;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of nodes allocated
+*/
+/**************************************************************************/
+uint16_t FRAM_BTree::getNodesUsed(void)
+{
+	return _nodesUsed;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of nodes fitting in the area
+*/
+/**************************************************************************/
+uint16_t FRAM_BTree::getNodesMax(void)
+{
+	return _nodesMax;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Checks the header, the journal and the nodes fit the memory map:
+				node addresses are 16 bits and would wrap past 0xFFFF
+*/
+/**************************************************************************/
+byte FRAM_BTree::checkLayout(void)
+{
+	uint32_t end = (uint32_t) _framAddr + FRAM_BTREE_HEADER_SIZE + FRAM_BTREE_JOURNAL_SIZE + (uint32_t) _nodesMax * FRAM_BTREE_NODE_SIZE;
+	if (end > _fram->getMaxAddress()) return ERROR_11;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of a node
+*/
+/**************************************************************************/
+uint16_t FRAM_BTree::nodeAddr(uint16_t index)
+{
+	return _framAddr + FRAM_BTREE_HEADER_SIZE + FRAM_BTREE_JOURNAL_SIZE + index * FRAM_BTREE_NODE_SIZE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads a node with one burst. Cache slot n holds the last internal
+				node read on level n, so the root stays pinned and each of the
+				upper levels keeps the node of the last descent. Nodes below
+				FRAM_BTREE_CACHE_NODES levels are always read from the chip.
+
+    @params[in] index
+                Index of the node
+    @params[in] level
+                Level of the node, 0 for the root
+    @params[out] node[]
+                The node image
+    @returns
+					return code of the burst read
+*/
+/**************************************************************************/
+byte FRAM_BTree::readNode(uint16_t index, uint8_t level, uint8_t node[])
+{
+	uint8_t slot = level;
+	if ((slot < FRAM_BTREE_CACHE_NODES) && (_cacheIndex[slot] == index)) {
+		memcpy(node, _cache[slot], FRAM_BTREE_NODE_SIZE);
+		return ERROR_0;
+	}
+
+	byte result = _fram->readBlock(FRAM_BTree::nodeAddr(index), FRAM_BTREE_NODE_SIZE, node);
+	if ((result == ERROR_0) && (slot < FRAM_BTREE_CACHE_NODES) && (node[0] != FRAM_BTREE_LEAF)) {
+		memcpy(_cache[slot], node, FRAM_BTREE_NODE_SIZE);
+		_cacheIndex[slot] = index;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walks down from the root to the leaf which may hold a key. The
+				leaf is left in _node.
+
+    @params[out] path[]
+                Internal nodes visited, from the root
+    @params[out] *leaf
+                Index of the leaf
+    @returns
+					0: success
+					12: tree not opened or inconsistent
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::findLeaf(uint32_t key, uint16_t path[], uint16_t *leaf)
+{
+	if (_height == 0) return ERROR_12;
+
+	uint16_t index = _root;
+	byte result;
+	for (uint8_t level = 0; level < _height; level++) {
+		result = FRAM_BTree::readNode(index, level, _node);
+		if (result != ERROR_0) return result;
+		if ((_node[0] == FRAM_BTREE_LEAF) != (level == (_height - 1))) return ERROR_12;
+		if (_node[1] > FRAM_BTREE_CAPACITY) return ERROR_12;
+		if (_node[0] == FRAM_BTREE_LEAF) break;
+		path[level] = index;
+		index = FRAM_BTree::childFor(_node, key);
+		if (index >= _nodesUsed) return ERROR_12;
+	}
+	*leaf = index;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Position of the first entry whose key is not lower than a key
+*/
+/**************************************************************************/
+uint8_t FRAM_BTree::lowerBound(const uint8_t node[], uint32_t key)
+{
+	uint8_t low = 0;
+	uint8_t high = node[1];
+	uint8_t middle;
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (getLong(ENTRY(node, middle)) < key) low = middle + 1;
+		else high = middle;
+	}
+	return low;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Child of an internal node covering a key
+*/
+/**************************************************************************/
+uint16_t FRAM_BTree::childFor(const uint8_t node[], uint32_t key)
+{
+	uint8_t pos = FRAM_BTree::lowerBound(node, key);
+	if ((pos < node[1]) && (getLong(ENTRY(node, pos)) == key)) return getWord(ENTRY(node, pos) + 4);
+	if (pos == 0) return getWord(node + 2);
+	return getWord(ENTRY(node, pos - 1) + 4);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Inserts an entry in a node buffer, which may hold one entry more
+				than FRAM_BTREE_CAPACITY before a split
+*/
+/**************************************************************************/
+void FRAM_BTree::insertEntry(uint8_t node[], uint8_t pos, uint32_t key, uint16_t value)
+{
+	memmove(ENTRY(node, pos + 1), ENTRY(node, pos), (uint16_t) (node[1] - pos) * FRAM_BTREE_ENTRY_SIZE);
+	putLong(ENTRY(node, pos), key);
+	putWord(ENTRY(node, pos) + 4, value);
+	node[1]++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Builds the header from the tree state, padded to a node size
+				for the journal
+*/
+/**************************************************************************/
+void FRAM_BTree::headerImage(uint8_t image[])
+{
+	memset(image, 0, FRAM_BTREE_NODE_SIZE);
+	image[0] = 'F';
+	image[1] = 'B';
+	image[2] = 'T';
+	image[3] = '1';
+	putWord(image + 4, _root);
+	image[6] = _height;
+	image[7] = FRAM_BTREE_NODE_SIZE;
+	putWord(image + 8, _nodesUsed);
+	putLong(image + 10, _entries);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the header and checks it against the area
+
+    @returns
+					0: success
+					12: not a tree, or built with another node size
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::loadHeader(void)
+{
+	uint8_t header[FRAM_BTREE_HEADER_SIZE];
+	_height = 0;
+	byte result = _fram->readBlock(_framAddr, FRAM_BTREE_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+	if ((header[0] != 'F') || (header[1] != 'B') || (header[2] != 'T') || (header[3] != '1')) return ERROR_12;
+	if ((header[7] != FRAM_BTREE_NODE_SIZE) || (header[6] == 0) || (header[6] > FRAM_BTREE_MAX_HEIGHT)) return ERROR_12;
+
+	uint16_t nodesUsed = getWord(header + 8);
+	uint16_t root = getWord(header + 4);
+	if ((nodesUsed > _nodesMax) || (root >= nodesUsed)) return ERROR_12;
+	_root = root;
+	_height = header[6];
+	_nodesUsed = nodesUsed;
+	_entries = getLong(header + 10);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks a node read from the chip
+
+    @params[in] leaf
+                true when the node is on the last level
+    @params[in] low
+                Lowest key allowed by the separators of the parents
+    @params[in] high
+                Key above the keys allowed, 2^32 for no limit
+    @returns
+					0: node consistent
+					FRAM_FSCK_NODE, FRAM_FSCK_ORDER or FRAM_FSCK_LINK: first inconsistency
+*/
+/**************************************************************************/
+uint8_t FRAM_BTree::checkNode(const uint8_t node[], boolean leaf, uint32_t low, uint64_t high)
+{
+	if (node[0] != (leaf ? FRAM_BTREE_LEAF : 0)) return FRAM_FSCK_NODE;
+	if (node[1] > FRAM_BTREE_CAPACITY) return FRAM_FSCK_NODE;
+
+	uint32_t key;
+	for (uint8_t i = 0; i < node[1]; i++) {
+		key = getLong(ENTRY(node, i));
+		if ((key < low) || (key >= high)) return FRAM_FSCK_ORDER;
+		if ((i > 0) && (key <= getLong(ENTRY(node, i - 1)))) return FRAM_FSCK_ORDER;
+	}
+
+	uint16_t next = getWord(node + 2);
+	if (leaf && (next != FRAM_BTREE_NONE) && (next >= _nodesUsed)) return FRAM_FSCK_LINK;
+	return 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts a journaled modification
+*/
+/**************************************************************************/
+void FRAM_BTree::journalBegin(void)
+{
+	_journalCount = 0;
+	_journalCrc = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the new image of a node to the next journal slot
+
+    @params[in] index
+                Node index, FRAM_BTREE_NONE for the tree header
+    @params[in] image[]
+                FRAM_BTREE_NODE_SIZE bytes
+    @returns
+					0: success
+					16: journal full
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::journalAdd(uint16_t index, const uint8_t image[])
+{
+	if (_journalCount == FRAM_BTREE_JOURNAL_SLOTS) return ERROR_16;
+
+	uint16_t slot = _framAddr + FRAM_BTREE_HEADER_SIZE + 6 + _journalCount * (2 + FRAM_BTREE_NODE_SIZE);
+	uint8_t tag[2];
+	putWord(tag, index);
+	byte result = _fram->writeArray(slot, 2, tag);
+	if (result == ERROR_0) result = _fram->writeBlock(slot + 2, FRAM_BTREE_NODE_SIZE, (uint8_t *) image);
+	if (result != ERROR_0) return result;
+
+	_journalCrc = FRAM_Image::crc32Update(_journalCrc, tag, 2);
+	_journalCrc = FRAM_Image::crc32Update(_journalCrc, image, FRAM_BTREE_NODE_SIZE);
+	_journalCount++;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Commits the journal then copies the slots to their nodes. The
+				state byte is written last: a single byte write can not be torn.
+
+    @returns
+					return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::journalCommit(void)
+{
+	uint16_t journal = _framAddr + FRAM_BTREE_HEADER_SIZE;
+	uint8_t record[5];
+	record[0] = _journalCount;
+	putLong(record + 1, _journalCrc);
+	byte result = _fram->writeArray(journal + 1, 5, record);
+	if (result == ERROR_0) result = _fram->writeByte(journal, FRAM_BTREE_JOURNAL_COMMITTED);
+	if (result != ERROR_0) return result;
+
+	result = FRAM_BTree::journalApply();
+	if (result != ERROR_0) return result;
+	return _fram->writeByte(journal, FRAM_BTREE_JOURNAL_IDLE);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Copies the committed slots to their nodes, chip to chip. Applying
+				twice gives the same result, recovery may replay a partial apply.
+
+    @returns
+					return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::journalApply(void)
+{
+	uint16_t slot = _framAddr + FRAM_BTREE_HEADER_SIZE + 6;
+	uint16_t index;
+	uint8_t tag[2];
+	byte result = ERROR_0;
+
+	for (uint8_t i = 0; (i < _journalCount) && (result == ERROR_0); i++) {
+		result = _fram->readArray(slot, 2, tag);
+		if (result != ERROR_0) break;
+		index = getWord(tag);
+		if (index == FRAM_BTREE_NONE) {
+			result = FRAM_MB85RC_I2C::copy(_fram, slot + 2, _fram, _framAddr, FRAM_BTREE_HEADER_SIZE);
+		}
+		else {
+			result = FRAM_MB85RC_I2C::copy(_fram, slot + 2, _fram, FRAM_BTree::nodeAddr(index), FRAM_BTREE_NODE_SIZE);
+			// a root split moves nodes one level down, any slot may hold the node
+			for (uint8_t j = 0; j < FRAM_BTREE_CACHE_NODES; j++) {
+				if (_cacheIndex[j] == index) _cacheIndex[j] = FRAM_BTREE_NONE;
+			}
+		}
+		slot += 2 + FRAM_BTREE_NODE_SIZE;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the journal state and checks the CRC32 of a committed
+				journal
+
+    @params[out] record[]
+                6 bytes: state, slot count, CRC32
+    @params[out] *valid
+                true for a committed journal with a good CRC32
+    @returns
+					return code of the burst reads
+*/
+/**************************************************************************/
+byte FRAM_BTree::journalCheck(uint8_t record[], boolean *valid)
+{
+	uint16_t journal = _framAddr + FRAM_BTREE_HEADER_SIZE;
+	*valid = false;
+	byte result = _fram->readArray(journal, 6, record);
+	if (result != ERROR_0) return result;
+	if ((record[0] != FRAM_BTREE_JOURNAL_COMMITTED) || (record[1] > FRAM_BTREE_JOURNAL_SLOTS)) return ERROR_0;
+
+	uint32_t crc = 0;
+	uint16_t slot = journal + 6;
+	for (uint8_t i = 0; i < record[1]; i++) {
+		result = _fram->readBlock(slot, 2 + FRAM_BTREE_NODE_SIZE, _node);
+		if (result != ERROR_0) return result;
+		crc = FRAM_Image::crc32Update(crc, _node, 2 + FRAM_BTREE_NODE_SIZE);
+		slot += 2 + FRAM_BTREE_NODE_SIZE;
+	}
+	*valid = (crc == getLong(record + 2));
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Completes a committed modification after a power loss
+
+    @returns
+					0: nothing to recover or recovery done
+					12: committed journal with a bad CRC
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_BTree::journalRecover(void)
+{
+	uint8_t record[6];
+	boolean valid;
+	byte result = FRAM_BTree::journalCheck(record, &valid);
+	if (result != ERROR_0) return result;
+	if (record[0] != FRAM_BTREE_JOURNAL_COMMITTED) return ERROR_0;
+	if (!valid) return ERROR_12;
+
+	_journalCount = record[1];
+	result = FRAM_BTree::journalApply();
+	if (result != ERROR_0) return result;
+	return _fram->writeByte(_framAddr + FRAM_BTREE_HEADER_SIZE, FRAM_BTREE_JOURNAL_IDLE);
+}
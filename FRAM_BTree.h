@@ -0,0 +1,144 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_BTree.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Ordered B+tree index stored in FRAM: 32 bits keys, 16 bits values (typically
+	the FRAM address of a record). Fixed size nodes are read with one burst,
+	the root and the upper levels are cached in RAM and leaves are linked for
+	range scans. Every modification goes through a redo journal, a power loss
+	during a node split leaves the tree as before or after the insertion.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_BTREE_H_
+#define _FRAM_BTREE_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_Fsck.h"
+
+// Node size in bytes: 4 bytes node header + 6 bytes per entry
+#ifndef FRAM_BTREE_NODE_SIZE
+#define FRAM_BTREE_NODE_SIZE 64
+#endif
+
+// Number of tree levels cached in RAM, one internal node each: the root, then the last
+// node visited on each level below it
+#ifndef FRAM_BTREE_CACHE_NODES
+#define FRAM_BTREE_CACHE_NODES 2
+#endif
+
+// Maximum tree height, sizes the journal
+#ifndef FRAM_BTREE_MAX_HEIGHT
+#define FRAM_BTREE_MAX_HEIGHT 6
+#endif
+
+#define FRAM_BTREE_ENTRY_SIZE 6
+#define FRAM_BTREE_CAPACITY ((FRAM_BTREE_NODE_SIZE - 4) / FRAM_BTREE_ENTRY_SIZE)
+#define FRAM_BTREE_HEADER_SIZE 16
+#define FRAM_BTREE_JOURNAL_SLOTS (2 * FRAM_BTREE_MAX_HEIGHT + 2)
+#define FRAM_BTREE_JOURNAL_SIZE (6 + FRAM_BTREE_JOURNAL_SLOTS * (2 + FRAM_BTREE_NODE_SIZE))
+#define FRAM_BTREE_NONE 0xFFFF
+
+/*
+	Area layout
+		header		16 bytes: magic "FBT1", root node, height, nodes used, entries
+		journal		state, slot count, CRC32, then slots of node index + node image
+		nodes		FRAM_BTREE_NODE_SIZE bytes each
+
+	Node layout - multi-bytes values are little endian
+		1 byte		1: leaf, 0: internal
+		1 byte		entry count
+		2 bytes		leaf: next leaf, internal: child for keys lower than the first key
+		entries		4 bytes key + 2 bytes value (leaf) or child (internal)
+*/
+
+// Range scan callback, return false to stop the scan
+typedef boolean (*FRAM_BTreeVisitor)(uint32_t key, uint16_t value, void *context);
+
+
+class FRAM_BTree {
+ public:
+	FRAM_BTree(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size);
+
+	byte	format(void);
+	byte	begin(void);
+	byte	check(FRAM_FsckReport *report, boolean repair);
+	byte	lookup(uint32_t key, uint16_t *value);
+	byte	insert(uint32_t key, uint16_t value);
+	byte	remove(uint32_t key);
+	byte	scan(uint32_t from, uint32_t to, FRAM_BTreeVisitor visitor, void *context);
+	uint32_t	getEntries(void);
+	uint8_t	getHeight(void);
+	uint16_t	getNodesUsed(void);
+	uint16_t	getNodesMax(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint16_t	_nodesMax;
+	uint16_t	_root;
+	uint8_t	_height;
+	uint16_t	_nodesUsed;
+	uint32_t	_entries;
+
+	uint8_t	_node[FRAM_BTREE_NODE_SIZE + FRAM_BTREE_ENTRY_SIZE];
+	uint8_t	_split[FRAM_BTREE_NODE_SIZE];
+	uint8_t	_cache[FRAM_BTREE_CACHE_NODES][FRAM_BTREE_NODE_SIZE];
+	uint16_t	_cacheIndex[FRAM_BTREE_CACHE_NODES];
+
+	uint8_t	_journalCount;
+	uint32_t	_journalCrc;
+
+	byte	checkLayout(void);
+	uint16_t	nodeAddr(uint16_t index);
+	byte	readNode(uint16_t index, uint8_t level, uint8_t node[]);
+	byte	findLeaf(uint32_t key, uint16_t path[], uint16_t *leaf);
+	uint8_t	lowerBound(const uint8_t node[], uint32_t key);
+	uint16_t	childFor(const uint8_t node[], uint32_t key);
+	void	insertEntry(uint8_t node[], uint8_t pos, uint32_t key, uint16_t value);
+	void	headerImage(uint8_t image[]);
+	byte	loadHeader(void);
+	uint8_t	checkNode(const uint8_t node[], boolean leaf, uint32_t low, uint64_t high);
+
+	void	journalBegin(void);
+	byte	journalAdd(uint16_t index, const uint8_t image[]);
+	byte	journalCommit(void);
+	byte	journalApply(void);
+	byte	journalCheck(uint8_t record[], boolean *valid);
+	byte	journalRecover(void);
+};
+
+#endif
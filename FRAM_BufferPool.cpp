@@ -0,0 +1,145 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_BufferPool.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Static transfer buffer pool and arena.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_BufferPool.h"
+
+// Critical sections save the interrupt state and restore it on exit, so the
+// pool can be used from an ISR or with interrupts disabled on purpose.
+// Other cores fall back to noInterrupts() / interrupts().
+#if defined(__AVR__)
+ #define FRAM_POOL_LOCK(state) uint8_t state = SREG; cli()
+ #define FRAM_POOL_UNLOCK(state) SREG = state
+#elif defined(__ARM_ARCH_6M__) || defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_BASE__) || defined(__ARM_ARCH_8M_MAIN__)
+ #define FRAM_POOL_LOCK(state) uint32_t state; __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (state) :: "memory")
+ #define FRAM_POOL_UNLOCK(state) __asm__ volatile ("msr primask, %0" :: "r" (state) : "memory")
+#else
+ #define FRAM_POOL_LOCK(state) noInterrupts()
+ #define FRAM_POOL_UNLOCK(state) interrupts()
+#endif
+
+uint8_t FRAM_BufferPool::_buffers[FRAM_POOL_BUFFERS][FRAM_POOL_BUFFER_SIZE];
+uint8_t FRAM_BufferPool::_used = 0;
+uint8_t FRAM_BufferPool::_highWater = 0;
+uint16_t FRAM_BufferPool::_failures = 0;
+uint8_t FRAM_BufferPool::_arena[FRAM_ARENA_SIZE];
+uint16_t FRAM_BufferPool::_arenaUsed = 0;
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Takes a free transfer buffer of FRAM_POOL_BUFFER_SIZE bytes. ISR
+				safe on AVR and Cortex-M, the interrupt state is restored.
+
+    @returns
+				pointer to the buffer, NULL if all buffers are in use
+*/
+/**************************************************************************/
+uint8_t *FRAM_BufferPool::acquire(void)
+{
+	uint8_t *buffer = NULL;
+	uint8_t inUse = 0;
+
+	FRAM_POOL_LOCK(state);
+	for (uint8_t i = 0; i < FRAM_POOL_BUFFERS; i++) {
+		if ((buffer == NULL) && !bitRead(_used, i)) {
+			bitSet(_used, i);
+			buffer = _buffers[i];
+		}
+		if (bitRead(_used, i)) inUse++;
+	}
+	if (inUse > _highWater) _highWater = inUse;
+	if (buffer == NULL) _failures++;
+	FRAM_POOL_UNLOCK(state);
+	return buffer;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gives a transfer buffer back to the pool. NULL is ignored. ISR
+				safe on AVR and Cortex-M, the interrupt state is restored.
+*/
+/**************************************************************************/
+void FRAM_BufferPool::release(uint8_t *buffer)
+{
+	if (buffer == NULL) return;
+	FRAM_POOL_LOCK(state);
+	bitClear(_used, (buffer - _buffers[0]) / FRAM_POOL_BUFFER_SIZE);
+	FRAM_POOL_UNLOCK(state);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of transfer buffers currently in use
+*/
+/**************************************************************************/
+uint8_t FRAM_BufferPool::getInUse(void)
+{
+	uint8_t inUse = 0;
+	for (uint8_t i = 0; i < FRAM_POOL_BUFFERS; i++) {
+		if (bitRead(_used, i)) inUse++;
+	}
+	return inUse;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Largest number of transfer buffers used at the same time
+*/
+/**************************************************************************/
+uint8_t FRAM_BufferPool::getHighWater(void)
+{
+	return _highWater;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of acquire() calls which found the pool exhausted
+*/
+/**************************************************************************/
+uint16_t FRAM_BufferPool::getFailures(void)
+{
+	return _failures;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Allocates a long lived buffer from the arena. Arena memory is never
+			freed, allocate cache buffers once in setup().
+
+    @params[in] size
+                Number of bytes
+    @returns
+				pointer to the buffer, NULL if the arena is too small
+*/
+/**************************************************************************/
+uint8_t *FRAM_BufferPool::arenaAlloc(uint16_t size)
+{
+	if (size > (FRAM_ARENA_SIZE - _arenaUsed)) return NULL;
+	uint8_t *buffer = _arena + _arenaUsed;
+	_arenaUsed += size;
+	return buffer;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of arena bytes allocated, the arena high-water mark
+*/
+/**************************************************************************/
+uint16_t FRAM_BufferPool::getArenaUsed(void)
+{
+	return _arenaUsed;
+}
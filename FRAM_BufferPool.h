@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_BufferPool.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Static transfer buffer pool and arena. Chunk buffers of the bulk functions
+	are taken from a fixed pool instead of the stack, long lived cache buffers
+	from a bump allocated arena. Both are sized at compile time and report
+	their high-water marks, keeping RAM use deterministic on small parts.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_BUFFERPOOL_H_
+#define _FRAM_BUFFERPOOL_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Number of transfer buffers - max 8
+#ifndef FRAM_POOL_BUFFERS
+#define FRAM_POOL_BUFFERS 4
+#endif
+#if (FRAM_POOL_BUFFERS > 8)
+ #error "FRAM_POOL_BUFFERS must not exceed 8"
+#endif
+
+// Size of each transfer buffer, at least FRAM_CHUNK_SIZE
+#ifndef FRAM_POOL_BUFFER_SIZE
+#define FRAM_POOL_BUFFER_SIZE FRAM_CHUNK_SIZE
+#endif
+#if (FRAM_POOL_BUFFER_SIZE < FRAM_CHUNK_SIZE)
+ #error "FRAM_POOL_BUFFER_SIZE must be at least FRAM_CHUNK_SIZE"
+#endif
+
+// Arena size in bytes for cache buffers (mirrors, files...)
+#ifndef FRAM_ARENA_SIZE
+#define FRAM_ARENA_SIZE 256
+#endif
+
+
+class FRAM_BufferPool {
+ public:
+	static uint8_t	*acquire(void);
+	static void	release(uint8_t *buffer);
+	static uint8_t	getInUse(void);
+	static uint8_t	getHighWater(void);
+	static uint16_t	getFailures(void);
+
+	static uint8_t	*arenaAlloc(uint16_t size);
+	static uint16_t	getArenaUsed(void);
+
+ private:
+	static uint8_t	_buffers[FRAM_POOL_BUFFERS][FRAM_POOL_BUFFER_SIZE];
+	static uint8_t	_used;
+	static uint8_t	_highWater;
+	static uint16_t	_failures;
+	static uint8_t	_arena[FRAM_ARENA_SIZE];
+	static uint16_t	_arenaUsed;
+};
+
+// Scoped pool buffer, released when leaving the block. data is NULL if the pool is exhausted.
+// Not copyable: a copy would release the same buffer twice.
+class FRAM_PoolBuffer {
+ public:
+	FRAM_PoolBuffer(void) { data = FRAM_BufferPool::acquire(); }
+	~FRAM_PoolBuffer(void) { FRAM_BufferPool::release(data); }
+	uint8_t	*data;
+
+ private:
+	FRAM_PoolBuffer(const FRAM_PoolBuffer &);
+	FRAM_PoolBuffer &operator=(const FRAM_PoolBuffer &);
+};
+
+#endif
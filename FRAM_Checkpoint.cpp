@@ -0,0 +1,412 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Checkpoint.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Incremental application checkpoints with dirty page tracking.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Checkpoint.h"
+#include "FRAM_Image.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	The area size depends on the regions, see getAreaSize()
+*/
+/**************************************************************************/
+FRAM_Checkpoint::FRAM_Checkpoint(FRAM_MB85RC_I2C *fram, uint16_t framAddr)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_regions = 0;
+		_pages = 0;
+		_total = 0;
+		_seq = 0;
+		_hashing = true;
+		_full = true;
+		_synced = false;
+		_pagesWritten = 0;
+		memset(_hash, 0, sizeof(_hash));
+		memset(_marked, 0, sizeof(_marked));
+		memset(_previous, 0, sizeof(_previous));
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Registers a RAM region to checkpoint. All regions are registered
+				before the first restore() or checkpoint().
+
+    @params[in] ram
+                The region start
+    @params[in] len
+                The region size in bytes
+    @returns
+					0: success
+					8: length null
+					16: FRAM_CHECKPOINT_REGIONS or FRAM_CHECKPOINT_PAGES exceeded
+*/
+/**************************************************************************/
+byte FRAM_Checkpoint::addRegion(void *ram, uint16_t len)
+{
+	if (len == 0) return ERROR_8;
+	uint16_t pages = (len + FRAM_CHECKPOINT_PAGE_SIZE - 1) / FRAM_CHECKPOINT_PAGE_SIZE;
+	if ((_regions == FRAM_CHECKPOINT_REGIONS) || (((uint32_t) _pages + pages) > FRAM_CHECKPOINT_PAGES)) return ERROR_16;
+	if (((uint32_t) _total + len) > 0xFFFF) return ERROR_16;
+
+	_ram[_regions] = (uint8_t *) ram;
+	_len[_regions] = len;
+	_firstPage[_regions] = _pages;
+	_regions++;
+	_pages += pages;
+	_total += len;
+	_full = true;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks bytes modified since the last checkpoint. Required when
+				hashing is disabled, optional otherwise.
+
+    @params[in] ram
+                First modified byte, within a registered region
+    @params[in] len
+                Number of modified bytes
+*/
+/**************************************************************************/
+void FRAM_Checkpoint::markDirty(const void *ram, uint16_t len)
+{
+	const uint8_t *p = (const uint8_t *) ram;
+	uint16_t offset, first, last, page;
+
+	if (len == 0) return;
+	for (uint8_t r = 0; r < _regions; r++) {
+		if ((p < _ram[r]) || (p >= (_ram[r] + _len[r]))) continue;
+		offset = p - _ram[r];
+		if (len > (_len[r] - offset)) len = _len[r] - offset;
+		first = _firstPage[r] + offset / FRAM_CHECKPOINT_PAGE_SIZE;
+		last = _firstPage[r] + (offset + len - 1) / FRAM_CHECKPOINT_PAGE_SIZE;
+		for (page = first; page <= last; page++) bitSet(_marked[page >> 3], page & 0x07);
+		return;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables the detection of modified pages by a 16 bits hash of
+				each page, on by default. With hashing off, only the pages
+				given to markDirty() are written.
+				Hashing may miss a change whose hash collides, about 1 in 65536;
+				markDirty() is exact.
+*/
+/**************************************************************************/
+void FRAM_Checkpoint::setHashing(boolean enable)
+{
+	if (enable && !_hashing) {
+		FRAM_Checkpoint::updateHashes();
+		_full = true;
+	}
+	_hashing = enable;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the pages modified since the previous checkpoint, and the
+				ones modified before it which the target copy lacks. Adjacent
+				pages of a region are written as one burst sequence. The header
+				of the copy is erased first and written last: a power loss keeps
+				the previous checkpoint. Page hashes and the pages the other
+				copy lacks are kept aside and only taken into account once
+				the header is written.
+
+    @returns
+					0: success
+					8: no region registered
+					11: area out of the memory map
+					other: return code of Wire.endTransmission(), the next
+					checkpoint rewrites all pages
+*/
+/**************************************************************************/
+byte FRAM_Checkpoint::checkpoint(void)
+{
+	if (_regions == 0) return ERROR_8;
+	if (((uint32_t) _framAddr + FRAM_Checkpoint::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+
+	byte result;
+	if (!_synced) {
+		result = FRAM_Checkpoint::findLatest(&_seq);
+		if ((result != ERROR_0) && (result != ERROR_15)) return result;
+		_synced = true;
+	}
+
+	uint32_t seq = _seq + 1;
+	uint16_t copy = FRAM_Checkpoint::copyAddr(seq);
+	uint16_t headerAddr = _framAddr + (seq & 1) * FRAM_CHECKPOINT_HEADER_SIZE;
+	result = _fram->writeByte(headerAddr, 0);
+	if (result != ERROR_0) return result;
+
+	uint16_t regionOffset = 0;
+	uint16_t page, global, start, end, hash;
+	int32_t runStart;
+	boolean dirty, previous;
+
+	_pagesWritten = 0;
+	for (uint8_t r = 0; (r < _regions) && (result == ERROR_0); r++) {
+		runStart = -1;
+		for (page = 0; (page * FRAM_CHECKPOINT_PAGE_SIZE) < _len[r]; page++) {
+			global = _firstPage[r] + page;
+			dirty = bitRead(_marked[global >> 3], global & 0x07);
+			if (_hashing) {
+				hash = FRAM_Checkpoint::pageHash(r, page);
+				if (hash != _hash[global]) dirty = true;
+				_nextHash[global] = hash;
+			}
+			previous = bitRead(_previous[global >> 3], global & 0x07);
+			// a full pass leaves the other copy behind on every page
+			bitWrite(_nextPrevious[global >> 3], global & 0x07, _full || dirty);
+
+			if (_full || dirty || previous) {
+				if (runStart < 0) runStart = page * FRAM_CHECKPOINT_PAGE_SIZE;
+				_pagesWritten++;
+			}
+			else if (runStart >= 0) {
+				start = (uint16_t) runStart;
+				end = page * FRAM_CHECKPOINT_PAGE_SIZE;
+				result = _fram->writeBlock(copy + regionOffset + start, end - start, _ram[r] + start);
+				runStart = -1;
+				if (result != ERROR_0) break;
+			}
+		}
+		if ((result == ERROR_0) && (runStart >= 0)) {
+			start = (uint16_t) runStart;
+			result = _fram->writeBlock(copy + regionOffset + start, _len[r] - start, _ram[r] + start);
+		}
+		regionOffset += _len[r];
+	}
+
+	if (result == ERROR_0) {
+		uint8_t header[FRAM_CHECKPOINT_HEADER_SIZE];
+		FRAM_Checkpoint::buildHeader(seq, header);
+		result = _fram->writeArray(headerAddr, FRAM_CHECKPOINT_HEADER_SIZE, header);
+	}
+	if (result != ERROR_0) {
+		_full = true;
+		return result;
+	}
+	_seq = seq;
+	_full = false;
+	if (_hashing) memcpy(_hash, _nextHash, _pages * sizeof(uint16_t));
+	memcpy(_previous, _nextPrevious, sizeof(_previous));
+	memset(_marked, 0, sizeof(_marked));
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Loads the regions from the newest valid checkpoint, one maximal
+				burst sequence per region
+
+    @returns
+					0: success
+					8: no region registered
+					11: area out of the memory map
+					15: no valid checkpoint for this region layout
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Checkpoint::restore(void)
+{
+	if (_regions == 0) return ERROR_8;
+	if (((uint32_t) _framAddr + FRAM_Checkpoint::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+
+	uint32_t seq;
+	byte result = FRAM_Checkpoint::findLatest(&seq);
+	if (result != ERROR_0) return result;
+	_seq = seq;
+	_synced = true;
+
+	uint16_t copy = FRAM_Checkpoint::copyAddr(seq);
+	for (uint8_t r = 0; (r < _regions) && (result == ERROR_0); r++) {
+		result = _fram->readBlock(copy, _len[r], _ram[r]);
+		copy += _len[r];
+	}
+
+	// the other copy holds an older state: the next checkpoint rewrites it all
+	FRAM_Checkpoint::updateHashes();
+	memset(_marked, 0, sizeof(_marked));
+	memset(_previous, 0, sizeof(_previous));
+	_full = true;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sequence number of the newest checkpoint, 0 if none
+*/
+/**************************************************************************/
+uint32_t FRAM_Checkpoint::getSequence(void)
+{
+	return _seq;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of pages written by the last checkpoint
+*/
+/**************************************************************************/
+uint16_t FRAM_Checkpoint::getPagesWritten(void)
+{
+	return _pagesWritten;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes used on the chip: two headers and two copies
+*/
+/**************************************************************************/
+uint32_t FRAM_Checkpoint::getAreaSize(void)
+{
+	return 2UL * (FRAM_CHECKPOINT_HEADER_SIZE + _total);
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of the copy holding a sequence
+*/
+/**************************************************************************/
+uint16_t FRAM_Checkpoint::copyAddr(uint32_t seq)
+{
+	return _framAddr + 2 * FRAM_CHECKPOINT_HEADER_SIZE + (seq & 1) * _total;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fletcher-16 of a page of a region
+*/
+/**************************************************************************/
+uint16_t FRAM_Checkpoint::pageHash(uint8_t region, uint16_t page)
+{
+	uint16_t offset = page * FRAM_CHECKPOINT_PAGE_SIZE;
+	uint16_t len = _len[region] - offset;
+	if (len > FRAM_CHECKPOINT_PAGE_SIZE) len = FRAM_CHECKPOINT_PAGE_SIZE;
+
+	const uint8_t *p = _ram[region] + offset;
+	uint16_t a = 0;
+	uint16_t b = 0;
+	while (len--) {
+		a = (a + *p++) % 255;
+		b = (b + a) % 255;
+	}
+	return (b << 8) | a;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Takes the current RAM content as the hashing reference
+*/
+/**************************************************************************/
+void FRAM_Checkpoint::updateHashes(void)
+{
+	uint16_t page;
+	for (uint8_t r = 0; r < _regions; r++) {
+		for (page = 0; (page * FRAM_CHECKPOINT_PAGE_SIZE) < _len[r]; page++) {
+			_hash[_firstPage[r] + page] = FRAM_Checkpoint::pageHash(r, page);
+		}
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Builds the header of a copy. The layout CRC covers the region
+				lengths: a checkpoint is not restored into another layout.
+*/
+/**************************************************************************/
+void FRAM_Checkpoint::buildHeader(uint32_t seq, uint8_t header[])
+{
+	uint32_t layout = 0;
+	uint8_t len[2];
+	for (uint8_t r = 0; r < _regions; r++) {
+		len[0] = (uint8_t) _len[r];
+		len[1] = (uint8_t) (_len[r] >> 8);
+		layout = FRAM_Image::crc32Update(layout, len, 2);
+	}
+
+	header[0] = 'C';
+	header[1] = 'K';
+	header[2] = _regions;
+	header[3] = 0;
+	for (uint8_t i = 0; i < 4; i++) {
+		header[4 + i] = (uint8_t) (seq >> (8 * i));
+		header[8 + i] = (uint8_t) (layout >> (8 * i));
+	}
+	uint32_t crc = FRAM_Image::crc32Update(0, header, 12);
+	for (uint8_t i = 0; i < 4; i++) header[12 + i] = (uint8_t) (crc >> (8 * i));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the header of a copy and checks it
+
+    @params[out] *seq
+                Sequence of the copy, 0 if invalid
+    @returns
+					return code of the burst read
+*/
+/**************************************************************************/
+byte FRAM_Checkpoint::readHeader(uint8_t copy, uint32_t *seq)
+{
+	uint8_t header[FRAM_CHECKPOINT_HEADER_SIZE];
+	uint8_t expected[FRAM_CHECKPOINT_HEADER_SIZE];
+
+	*seq = 0;
+	byte result = _fram->readArray(_framAddr + copy * FRAM_CHECKPOINT_HEADER_SIZE, FRAM_CHECKPOINT_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+
+	uint32_t stored = header[4] | ((uint32_t) header[5] << 8) | ((uint32_t) header[6] << 16) | ((uint32_t) header[7] << 24);
+	if ((stored & 1) != copy) return ERROR_0;
+	FRAM_Checkpoint::buildHeader(stored, expected);
+	if (memcmp(header, expected, FRAM_CHECKPOINT_HEADER_SIZE) == 0) *seq = stored;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Finds the newest valid copy
+
+    @params[out] *seq
+                Sequence of the newest copy, 0 if none
+    @returns
+					0: success
+					15: no valid copy
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Checkpoint::findLatest(uint32_t *seq)
+{
+	uint32_t a, b;
+	byte result = FRAM_Checkpoint::readHeader(0, &a);
+	if (result == ERROR_0) result = FRAM_Checkpoint::readHeader(1, &b);
+	if (result != ERROR_0) return result;
+
+	*seq = (a > b) ? a : b;
+	return (*seq == 0) ? ERROR_15 : ERROR_0;
+}
@@ -0,0 +1,117 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Checkpoint.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Incremental checkpoints of application RAM regions into an A/B area.
+	Pages changed since the previous checkpoint are found by hashing and / or
+	explicit marking, and written as coalesced bursts to the older copy, whose
+	header is rewritten last. restore() loads the newest valid copy.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_CHECKPOINT_H_
+#define _FRAM_CHECKPOINT_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Dirty tracking granularity in bytes
+#ifndef FRAM_CHECKPOINT_PAGE_SIZE
+#define FRAM_CHECKPOINT_PAGE_SIZE 64
+#endif
+
+// Maximum number of pages over all regions, 4 bytes of hashes each in RAM (current and pending)
+#ifndef FRAM_CHECKPOINT_PAGES
+#define FRAM_CHECKPOINT_PAGES 128
+#endif
+
+#ifndef FRAM_CHECKPOINT_REGIONS
+#define FRAM_CHECKPOINT_REGIONS 4
+#endif
+
+#define FRAM_CHECKPOINT_HEADER_SIZE 16
+
+/*
+	Area layout
+		header A, header B		"CK", region count, 0, sequence (4), layout CRC32 (4), header CRC32 (4)
+		copy A, copy B			regions back to back
+
+	The copy of sequence s is s & 1. Each checkpoint goes to the copy not
+	holding the newest state, its header is erased first and written last.
+*/
+
+class FRAM_Checkpoint {
+ public:
+	FRAM_Checkpoint(FRAM_MB85RC_I2C *fram, uint16_t framAddr);
+
+	byte	addRegion(void *ram, uint16_t len);
+	void	markDirty(const void *ram, uint16_t len);
+	void	setHashing(boolean enable);
+	byte	checkpoint(void);
+	byte	restore(void);
+	uint32_t	getSequence(void);
+	uint16_t	getPagesWritten(void);
+	uint32_t	getAreaSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint8_t	*_ram[FRAM_CHECKPOINT_REGIONS];
+	uint16_t	_len[FRAM_CHECKPOINT_REGIONS];
+	uint16_t	_firstPage[FRAM_CHECKPOINT_REGIONS];
+	uint8_t	_regions;
+	uint16_t	_pages;
+	uint16_t	_total;
+	uint32_t	_seq;
+	boolean	_hashing;
+	boolean	_full;
+	boolean	_synced;
+	uint16_t	_pagesWritten;
+
+	uint16_t	_hash[FRAM_CHECKPOINT_PAGES];
+	uint16_t	_nextHash[FRAM_CHECKPOINT_PAGES];
+	uint8_t	_marked[(FRAM_CHECKPOINT_PAGES + 7) / 8];
+	uint8_t	_previous[(FRAM_CHECKPOINT_PAGES + 7) / 8];
+	uint8_t	_nextPrevious[(FRAM_CHECKPOINT_PAGES + 7) / 8];
+
+	uint16_t	copyAddr(uint32_t seq);
+	uint16_t	pageHash(uint8_t region, uint16_t page);
+	void	updateHashes(void);
+	void	buildHeader(uint32_t seq, uint8_t header[]);
+	byte	readHeader(uint8_t copy, uint32_t *seq);
+	byte	findLatest(uint32_t *seq);
+};
+
+#endif
@@ -0,0 +1,361 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_ColumnTable.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Columnar (struct of arrays) table of fixed size records.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_ColumnTable.h"
+#include "FRAM_Image.h"
+
+#define FRAM_COLUMN_ROWS_OFFSET 10
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	fieldSizes gives the size in bytes of each field, in row order. The RAM
+	buffer holds FRAM_COLUMN_BUFFER_SIZE / row size rows.
+*/
+/**************************************************************************/
+FRAM_ColumnTable::FRAM_ColumnTable(FRAM_MB85RC_I2C *fram, uint16_t framAddr, const uint8_t fieldSizes[], uint8_t fields, uint16_t capacity)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_fields = fields;
+		_capacity = capacity;
+		_rows = 0;
+		_countSlot = 0;
+		_pending = 0;
+		_rowSize = 0;
+		for (uint8_t i = 0; (i < fields) && (i < FRAM_COLUMN_FIELDS); i++) {
+			_sizes[i] = fieldSizes[i];
+			_offsets[i] = _rowSize;
+			_rowSize += fieldSizes[i];
+		}
+		_bufferRows = ((_rowSize == 0) || ((FRAM_COLUMN_BUFFER_SIZE / _rowSize) > 255)) ? 255 : (FRAM_COLUMN_BUFFER_SIZE / _rowSize);
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Creates an empty table
+
+    @returns
+					0: success
+					8: no field or capacity null
+					10: too many fields, field size null or row larger than the RAM buffer
+					11: area out of the memory map
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::format(void)
+{
+	byte result = FRAM_ColumnTable::checkSchema();
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_COLUMN_HEADER_SIZE];
+	FRAM_ColumnTable::buildHeader(header);
+	for (uint8_t slot = 0; slot < 2; slot++) {
+		header[FRAM_COLUMN_ROWS_OFFSET + slot * 4] = 0;
+		header[FRAM_COLUMN_ROWS_OFFSET + slot * 4 + 1] = 0;
+		header[FRAM_COLUMN_ROWS_OFFSET + slot * 4 + 2] = 0xFF;
+		header[FRAM_COLUMN_ROWS_OFFSET + slot * 4 + 3] = 0xFF;
+	}
+	result = _fram->writeArray(_framAddr, FRAM_COLUMN_HEADER_SIZE, header);
+	if (result == ERROR_0) {
+		_rows = 0;
+		_countSlot = 0;
+		_pending = 0;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens an existing table, its schema must match. The larger of
+				the two row count copies is kept, a copy torn by a power loss
+				is ignored.
+
+    @returns
+					0: success
+					8, 10, 11: see format()
+					12: no table, other schema or both row counts corrupted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::begin(void)
+{
+	byte result = FRAM_ColumnTable::checkSchema();
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_COLUMN_HEADER_SIZE];
+	uint8_t expected[FRAM_COLUMN_HEADER_SIZE];
+	result = _fram->readArray(_framAddr, FRAM_COLUMN_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+	FRAM_ColumnTable::buildHeader(expected);
+	if (memcmp(header, expected, FRAM_COLUMN_ROWS_OFFSET) != 0) return ERROR_12;
+
+	uint16_t rowsA, rowsB;
+	boolean validA = FRAM_ColumnTable::decodeRows(header + FRAM_COLUMN_ROWS_OFFSET, &rowsA) && (rowsA <= _capacity);
+	boolean validB = FRAM_ColumnTable::decodeRows(header + FRAM_COLUMN_ROWS_OFFSET + 4, &rowsB) && (rowsB <= _capacity);
+	if (!validA && !validB) return ERROR_12;
+	if (validA && (!validB || (rowsA >= rowsB))) {
+		_rows = rowsA;
+		_countSlot = 0;
+	}
+	else {
+		_rows = rowsB;
+		_countSlot = 1;
+	}
+	_pending = 0;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Appends a row to the RAM buffer, flushed when full
+
+    @params[in] row[]
+                The fields packed in schema order
+    @returns
+					0: success
+					16: table full
+					other: see flush()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::append(const uint8_t row[])
+{
+	if (((uint32_t) _rows + _pending) >= _capacity) return ERROR_16;
+
+	for (uint8_t field = 0; field < _fields; field++) {
+		memcpy(FRAM_ColumnTable::pendingCell(field, _pending), row + _offsets[field], _sizes[field]);
+	}
+	_pending++;
+	if (_pending < _bufferRows) return ERROR_0;
+	return FRAM_ColumnTable::flush();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the buffered rows: one burst sequence per column, then
+				the new row count
+
+    @returns
+					0: success
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::flush(void)
+{
+	if (_pending == 0) return ERROR_0;
+
+	byte result = ERROR_0;
+	for (uint8_t field = 0; (field < _fields) && (result == ERROR_0); field++) {
+		result = _fram->writeBlock(FRAM_ColumnTable::getColumnAddr(field) + _rows * _sizes[field], _pending * _sizes[field], FRAM_ColumnTable::pendingCell(field, 0));
+	}
+	if (result == ERROR_0) result = FRAM_ColumnTable::writeRows(_rows + _pending);
+	if (result == ERROR_0) {
+		_rows += _pending;
+		_pending = 0;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads consecutive values of one field with one burst sequence,
+				rows still buffered are copied from RAM
+
+    @params[in] field
+                The field number in the schema
+    @params[in] firstRow
+                The first row to read
+    @params[in] rows
+                The number of rows
+    @params[out] values[]
+                rows x field size bytes
+    @returns
+					0: success
+					8: no row asked
+					11: field or rows out of range
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::readColumn(uint8_t field, uint16_t firstRow, uint16_t rows, uint8_t values[])
+{
+	if (rows == 0) return ERROR_8;
+	if ((field >= _fields) || (field >= FRAM_COLUMN_FIELDS)) return ERROR_11;
+	if (((uint32_t) firstRow + rows) > ((uint32_t) _rows + _pending)) return ERROR_11;
+
+	uint8_t size = _sizes[field];
+	uint16_t stored = 0;
+	byte result = ERROR_0;
+	if (firstRow < _rows) {
+		stored = ((_rows - firstRow) < rows) ? (_rows - firstRow) : rows;
+		result = _fram->readBlock(FRAM_ColumnTable::getColumnAddr(field) + firstRow * size, stored * size, values);
+	}
+	if ((result == ERROR_0) && (stored < rows)) {
+		memcpy(values + stored * size, FRAM_ColumnTable::pendingCell(field, firstRow + stored - _rows), (rows - stored) * size);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads all fields of a row, one read per column
+
+    @params[in] row
+                The row number
+    @params[out] values[]
+                The fields packed in schema order
+    @returns
+					0: success
+					11: row out of range
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::readRow(uint16_t row, uint8_t values[])
+{
+	byte result = ERROR_0;
+	for (uint8_t field = 0; (field < _fields) && (result == ERROR_0); field++) {
+		result = FRAM_ColumnTable::readColumn(field, row, 1, values + _offsets[field]);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of rows, buffered ones included
+*/
+/**************************************************************************/
+uint16_t FRAM_ColumnTable::getRows(void)
+{
+	return _rows + _pending;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Maximum number of rows
+*/
+/**************************************************************************/
+uint16_t FRAM_ColumnTable::getCapacity(void)
+{
+	return _capacity;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of the segment of a field, for direct bursts
+*/
+/**************************************************************************/
+uint16_t FRAM_ColumnTable::getColumnAddr(uint8_t field)
+{
+	return _framAddr + FRAM_COLUMN_HEADER_SIZE + (uint16_t) ((uint32_t) _capacity * _offsets[field]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes used on the chip: header and columns
+*/
+/**************************************************************************/
+uint32_t FRAM_ColumnTable::getAreaSize(void)
+{
+	return FRAM_COLUMN_HEADER_SIZE + (uint32_t) _capacity * _rowSize;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Checks the schema given to the constructor
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::checkSchema(void)
+{
+	if ((_fields == 0) || (_capacity == 0)) return ERROR_8;
+	if (_fields > FRAM_COLUMN_FIELDS) return ERROR_10;
+	for (uint8_t field = 0; field < _fields; field++) {
+		if (_sizes[field] == 0) return ERROR_10;
+	}
+	if (_rowSize > FRAM_COLUMN_BUFFER_SIZE) return ERROR_10;
+	if (((uint32_t) _framAddr + FRAM_ColumnTable::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Header fields up to the row count, the CRC32 covers the capacity
+				and the field sizes
+*/
+/**************************************************************************/
+void FRAM_ColumnTable::buildHeader(uint8_t header[])
+{
+	header[0] = 'C';
+	header[1] = 'T';
+	header[2] = _fields;
+	header[3] = 0;
+	header[4] = (uint8_t) _capacity;
+	header[5] = (uint8_t) (_capacity >> 8);
+	uint32_t crc = FRAM_Image::crc32Update(0, header + 4, 2);
+	crc = FRAM_Image::crc32Update(crc, _sizes, _fields);
+	header[6] = (uint8_t) crc;
+	header[7] = (uint8_t) (crc >> 8);
+	header[8] = (uint8_t) (crc >> 16);
+	header[9] = (uint8_t) (crc >> 24);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the row count and its complement with one transfer, to
+				the copy not holding the current count
+*/
+/**************************************************************************/
+byte FRAM_ColumnTable::writeRows(uint16_t rows)
+{
+	uint8_t count[4] = { (uint8_t) rows, (uint8_t) (rows >> 8), (uint8_t) ~rows, (uint8_t) (~rows >> 8) };
+	uint8_t slot = _countSlot ^ 1;
+	byte result = _fram->writeArray(_framAddr + FRAM_COLUMN_ROWS_OFFSET + slot * 4, 4, count);
+	if (result == ERROR_0) _countSlot = slot;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decodes a row count copy
+
+    @returns
+					true if the count matches its complement
+*/
+/**************************************************************************/
+boolean FRAM_ColumnTable::decodeRows(const uint8_t count[], uint16_t *rows)
+{
+	*rows = count[0] | ((uint16_t) count[1] << 8);
+	uint16_t check = count[2] | ((uint16_t) count[3] << 8);
+	return (*rows == (uint16_t) ~check);
+}
+
+/**************************************************************************/
+/*!
+    @brief  RAM address of a buffered value, columns are contiguous
+*/
+/**************************************************************************/
+uint8_t *FRAM_ColumnTable::pendingCell(uint8_t field, uint8_t row)
+{
+	return _buffer + _offsets[field] * _bufferRows + row * _sizes[field];
+}
@@ -0,0 +1,109 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_ColumnTable.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Columnar table: each field of a fixed record schema is stored in its
+	own contiguous segment, so that reading one channel over many rows is a
+	single burst sequence. Appended rows are buffered in RAM column by column
+	and flushed together.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_COLUMNTABLE_H_
+#define _FRAM_COLUMNTABLE_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+#ifndef FRAM_COLUMN_FIELDS
+#define FRAM_COLUMN_FIELDS 16
+#endif
+
+// RAM buffer of appended rows, split in one part per column
+#ifndef FRAM_COLUMN_BUFFER_SIZE
+#define FRAM_COLUMN_BUFFER_SIZE 128
+#endif
+
+#define FRAM_COLUMN_HEADER_SIZE 18
+
+/*
+	Area layout
+		header		"CT", field count, 0, capacity (2), layout CRC32 (4),
+					row count A: rows (2), ~rows (2), row count B: rows (2), ~rows (2)
+		columns		capacity x field size bytes for each field, in schema order
+
+	Rows are packed in schema order, without padding. The row count is
+	written after the column data of a flush, alternately to copy A and B:
+	a power loss drops the rows of that flush, a torn count leaves the other
+	copy valid and begin() keeps the larger valid count.
+*/
+
+class FRAM_ColumnTable {
+ public:
+	FRAM_ColumnTable(FRAM_MB85RC_I2C *fram, uint16_t framAddr, const uint8_t fieldSizes[], uint8_t fields, uint16_t capacity);
+
+	byte	format(void);
+	byte	begin(void);
+	byte	append(const uint8_t row[]);
+	byte	flush(void);
+	byte	readColumn(uint8_t field, uint16_t firstRow, uint16_t rows, uint8_t values[]);
+	byte	readRow(uint16_t row, uint8_t values[]);
+	uint16_t	getRows(void);
+	uint16_t	getCapacity(void);
+	uint16_t	getColumnAddr(uint8_t field);
+	uint32_t	getAreaSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint8_t	_fields;
+	uint8_t	_sizes[FRAM_COLUMN_FIELDS];
+	uint16_t	_offsets[FRAM_COLUMN_FIELDS];
+	uint16_t	_rowSize;
+	uint16_t	_capacity;
+	uint16_t	_rows;
+	uint8_t	_countSlot;
+	uint8_t	_pending;
+	uint8_t	_bufferRows;
+	uint8_t	_buffer[FRAM_COLUMN_BUFFER_SIZE];
+
+	byte	checkSchema(void);
+	void	buildHeader(uint8_t header[]);
+	byte	writeRows(uint16_t rows);
+	static boolean	decodeRows(const uint8_t count[], uint16_t *rows);
+	uint8_t	*pendingCell(uint8_t field, uint8_t row);
+};
+
+#endif
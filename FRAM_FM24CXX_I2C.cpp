@@ -120,8 +120,7 @@ byte FRAM_FM24CXX_I2C::writeArray (uint16_t framAddr, byte items, uint8_t values
 
 byte FRAM_FM24CXX_I2C::writeByte (uint16_t framAddr, uint8_t value)
 {
-	uint8_t buffer[] = {value}; 
-	return FRAM_FM24CXX_I2C::writeArray(framAddr, 1, buffer);
+	return FRAM_FM24CXX_I2C::writeArray(framAddr, 1, &value);
 }
 
 
@@ -186,10 +185,7 @@ byte FRAM_FM24CXX_I2C::readArray (uint16_t framAddr, byte items, uint8_t values[
 /**************************************************************************/
 byte FRAM_FM24CXX_I2C::readByte (uint16_t framAddr, uint8_t *value) 
 {
-	uint8_t buffer[1];
-	byte result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, buffer);
-	*value = buffer[0];
-	return result;
+	return FRAM_FM24CXX_I2C::readArray(framAddr, 1, value);
 }
 /**************************************************************************/
 /*!
@@ -207,9 +203,9 @@ byte FRAM_FM24CXX_I2C::readByte (uint16_t framAddr, uint8_t *value)
 /**************************************************************************/
 byte FRAM_FM24CXX_I2C::copyByte (uint16_t origAddr, uint16_t destAddr) 
 {
-	uint8_t buffer[1];
-	byte result = FRAM_FM24CXX_I2C::readByte(origAddr, buffer);
-	result = FRAM_FM24CXX_I2C::writeByte(destAddr, buffer[0]);
+	uint8_t data;
+	byte result = FRAM_FM24CXX_I2C::readByte(origAddr, &data);
+	if (result == ERROR_0) result = FRAM_FM24CXX_I2C::writeByte(destAddr, data);
 	return result;
 }
 
@@ -236,9 +232,9 @@ byte FRAM_FM24CXX_I2C::readBit(uint16_t framAddr, uint8_t bitNb, byte *bit)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, buffer);
-		*bit = bitRead(buffer[0], bitNb);
+		uint8_t data;
+		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, &data);
+		*bit = bitRead(data, bitNb);
 	}
 	return result;
 }
@@ -263,10 +259,12 @@ byte FRAM_FM24CXX_I2C::setOneBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, buffer);
-		bitSet(buffer[0], bitNb);
-		result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, buffer);
+		uint8_t data;
+		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			bitSet(data, bitNb);
+			result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, &data);
+		}
 	}
 	return result;
 }
@@ -290,10 +288,12 @@ byte FRAM_FM24CXX_I2C::clearOneBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, buffer);
-		bitClear(buffer[0], bitNb);
-		result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, buffer);
+		uint8_t data;
+		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			bitClear(data, bitNb);
+			result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, &data);
+		}
 	}
 	return result;
 }
@@ -317,17 +317,12 @@ byte FRAM_FM24CXX_I2C::toggleBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, buffer);
-		
-		if ( (buffer[0] & (1 << bitNb)) == (1 << bitNb) )
-		{
-			bitClear(buffer[0], bitNb);
+		uint8_t data;
+		result = FRAM_FM24CXX_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			data ^= (1 << bitNb);
+			result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, &data);
 		}
-		else {
-			bitSet(buffer[0], bitNb);
-		}
-		result = FRAM_FM24CXX_I2C::writeArray(framAddr, 1, buffer);
 	}
 	return result;
 }
@@ -345,10 +340,7 @@ byte FRAM_FM24CXX_I2C::toggleBit(uint16_t framAddr, uint8_t bitNb)
 /**************************************************************************/
 byte FRAM_FM24CXX_I2C::readWord(uint16_t framAddr, uint16_t *value)
 {
-	uint8_t buffer[2];
-	byte result = FRAM_FM24CXX_I2C::readArray(framAddr, 2, buffer);
-	*value = *reinterpret_cast<uint16_t *>(buffer);
-	return result;
+	return FRAM_FM24CXX_I2C::readArray(framAddr, 2, reinterpret_cast<uint8_t *>(value));
 }
 
 /**************************************************************************/
@@ -382,10 +374,7 @@ byte FRAM_FM24CXX_I2C::writeWord(uint16_t framAddr, uint16_t value)
 /**************************************************************************/
 byte FRAM_FM24CXX_I2C::readLong(uint16_t framAddr, uint32_t *value)
 {
-	uint8_t buffer[4];
-	byte result = FRAM_FM24CXX_I2C::readArray(framAddr, 4, buffer);
-	*value = *reinterpret_cast<uint32_t *>(buffer);
-	return result;
+	return FRAM_FM24CXX_I2C::readArray(framAddr, 4, reinterpret_cast<uint8_t *>(value));
 
 }
 /**************************************************************************/
@@ -0,0 +1,318 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_File.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    File-like access to a chip or a named region through the Stream interface.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_File.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+*/
+/**************************************************************************/
+FRAM_File::FRAM_File(FRAM_MB85RC_I2C *fram)
+{
+		_fram = fram;
+		_start = 0;
+		_len = 0;
+		_pos = 0;
+		_pageStart = 0;
+		_pageValid = false;
+		_pageDirty = false;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Opens the whole memory map of the chip as a file
+
+    @returns
+				true: success
+				false: chip not identified
+*/
+/**************************************************************************/
+boolean FRAM_File::open(void)
+{
+	return FRAM_File::open(0, _fram->getMaxAddress());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens a memory area as a file, the position is set to 0
+
+    @params[in] framAddr
+                The 16-bit address of the first byte of the file
+    @params[in] len
+                The file size in bytes
+    @returns
+				true: success
+				false: empty area or out of the memory map
+*/
+/**************************************************************************/
+boolean FRAM_File::open(uint16_t framAddr, uint32_t len)
+{
+	FRAM_File::close();
+	if ((len == 0) || (((uint32_t) framAddr + len) > _fram->getMaxAddress())) return false;
+	_start = framAddr;
+	_len = len;
+	return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens a named region of a memory layout as a file
+
+    @params[in] layout
+                Array of regions describing the memory layout
+    @params[in] count
+                Number of regions in the array
+    @params[in] name
+                Name of the region to open
+    @returns
+				true: success
+				false: region not found or out of the memory map
+*/
+/**************************************************************************/
+boolean FRAM_File::open(const FRAM_Region *layout, uint8_t count, const char *name)
+{
+	for (uint8_t i = 0; i < count; i++) {
+		if (strcmp(layout[i].name, name) == 0) return FRAM_File::open(layout[i].start, layout[i].length);
+	}
+	FRAM_File::close();
+	return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes pending data back and closes the file
+*/
+/**************************************************************************/
+void FRAM_File::close(void)
+{
+	FRAM_File::flush();
+	_len = 0;
+	_pos = 0;
+	_pageValid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Moves the read / write position
+
+    @params[in] pos
+                New position from the beginning of the file
+    @returns
+				true: success
+				false: position beyond the end of the file
+*/
+/**************************************************************************/
+boolean FRAM_File::seek(uint32_t pos)
+{
+	if (pos > _len) return false;
+	_pos = pos;
+	return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Current read / write position from the beginning of the file
+*/
+/**************************************************************************/
+uint32_t FRAM_File::position(void)
+{
+	return _pos;
+}
+
+/**************************************************************************/
+/*!
+    @brief  File size in bytes, 0 if no file is opened
+*/
+/**************************************************************************/
+uint32_t FRAM_File::size(void)
+{
+	return _len;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes between the position and the end of the file,
+			capped to the int range of the platform
+*/
+/**************************************************************************/
+int FRAM_File::available(void)
+{
+	uint32_t remaining = _len - _pos;
+	return (remaining > 0x7FFF) ? 0x7FFF : (int) remaining;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads one byte and moves the position
+
+    @returns
+				the byte read, -1 at the end of the file or on bus error
+*/
+/**************************************************************************/
+int FRAM_File::read(void)
+{
+	int value = FRAM_File::peek();
+	if (value >= 0) _pos++;
+	return value;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads one byte without moving the position
+
+    @returns
+				the byte read, -1 at the end of the file or on bus error
+*/
+/**************************************************************************/
+int FRAM_File::peek(void)
+{
+	if (_pos >= _len) return -1;
+	if (FRAM_File::loadPage(_pos, true) != ERROR_0) return -1;
+	return _page[_pos - _pageStart];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes one byte to the page cache and moves the position
+
+    @returns
+				1: success
+				0: end of file or bus error, see getWriteError()
+*/
+/**************************************************************************/
+size_t FRAM_File::write(uint8_t value)
+{
+	return FRAM_File::write(&value, 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes bytes through the page cache and moves the position.
+			Pages fully overwritten are not read from the chip beforehand.
+
+    @params[in] buffer
+                The bytes to write
+    @params[in] size
+                The number of bytes
+    @returns
+				number of bytes written, less than size at the end of the file
+				or on bus error, see getWriteError()
+*/
+/**************************************************************************/
+size_t FRAM_File::write(const uint8_t *buffer, size_t size)
+{
+	size_t done = 0;
+	uint8_t offset, count, pageLen;
+	byte result;
+
+	while ((done < size) && (_pos < _len)) {
+		offset = (uint8_t) (_pos % FRAM_FILE_PAGE_SIZE);
+		pageLen = FRAM_File::pageLength(_pos - offset);
+		count = pageLen - offset;
+		if (count > (size - done)) count = (uint8_t) (size - done);
+
+		result = FRAM_File::loadPage(_pos, (offset != 0) || (count != pageLen));
+		if (result != ERROR_0) {
+			setWriteError(result);
+			break;
+		}
+		memcpy(_page + offset, buffer + done, count);
+		_pageDirty = true;
+		_pos += count;
+		done += count;
+	}
+	return done;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the page cache back to the chip if modified.
+			A bus error is reported by getWriteError().
+*/
+/**************************************************************************/
+void FRAM_File::flush(void)
+{
+	byte result = FRAM_File::writeBack();
+	if (result != ERROR_0) setWriteError(result);
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Makes the page holding a position the cached page
+
+    @params[in] pos
+                Position in the file
+    @params[in] fetch
+                false when the caller overwrites the whole page, no read needed
+    @returns
+				return code of the burst transfers
+*/
+/**************************************************************************/
+byte FRAM_File::loadPage(uint32_t pos, boolean fetch)
+{
+	uint32_t pageStart = pos - (pos % FRAM_FILE_PAGE_SIZE);
+	if (_pageValid && (pageStart == _pageStart)) return ERROR_0;
+
+	byte result = FRAM_File::writeBack();
+	if (result != ERROR_0) return result;
+
+	_pageValid = false;
+	if (fetch) {
+		result = _fram->readBlock(_start + (uint16_t) pageStart, FRAM_File::pageLength(pageStart), _page);
+		if (result != ERROR_0) return result;
+	}
+	_pageStart = pageStart;
+	_pageValid = true;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the cached page to the chip if modified
+
+    @returns
+				return code of the burst transfers
+*/
+/**************************************************************************/
+byte FRAM_File::writeBack(void)
+{
+	if (!_pageValid || !_pageDirty) return ERROR_0;
+	byte result = _fram->writeBlock(_start + (uint16_t) _pageStart, FRAM_File::pageLength(_pageStart), _page);
+	if (result == ERROR_0) _pageDirty = false;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Length of a page, the last one of the file may be shorter
+*/
+/**************************************************************************/
+uint8_t FRAM_File::pageLength(uint32_t pageStart)
+{
+	uint32_t remaining = _len - pageStart;
+	return (remaining > FRAM_FILE_PAGE_SIZE) ? FRAM_FILE_PAGE_SIZE : (uint8_t) remaining;
+}
@@ -0,0 +1,97 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_File.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    File-like access to a chip or to one of its named regions through the
+	Arduino Stream interface, so print(), readBytes(), parseInt()... work on FRAM.
+	A one page cache coalesces small reads and writes into bursts.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_FILE_H_
+#define _FRAM_FILE_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Page cache size in bytes - max 255
+#ifndef FRAM_FILE_PAGE_SIZE
+#define FRAM_FILE_PAGE_SIZE 64
+#endif
+
+// Named memory region, used to describe the memory layout of an application
+typedef struct {
+	const char	*name;
+	uint16_t	start;
+	uint32_t	length;
+} FRAM_Region;
+
+
+class FRAM_File : public Stream {
+ public:
+	FRAM_File(FRAM_MB85RC_I2C *fram);
+
+	boolean	open(void);
+	boolean	open(uint16_t framAddr, uint32_t len);
+	boolean	open(const FRAM_Region *layout, uint8_t count, const char *name);
+	void	close(void);
+	boolean	seek(uint32_t pos);
+	uint32_t	position(void);
+	uint32_t	size(void);
+
+	virtual int	available(void);
+	virtual int	read(void);
+	virtual int	peek(void);
+	virtual size_t	write(uint8_t value);
+	virtual size_t	write(const uint8_t *buffer, size_t size);
+	virtual void	flush(void);
+	using Print::write;
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_start;
+	uint32_t	_len;
+	uint32_t	_pos;
+	uint8_t	_page[FRAM_FILE_PAGE_SIZE];
+	uint32_t	_pageStart;
+	boolean	_pageValid;
+	boolean	_pageDirty;
+
+	byte	loadPage(uint32_t pos, boolean fetch);
+	byte	writeBack(void);
+	uint8_t	pageLength(uint32_t pageStart);
+};
+
+#endif
@@ -0,0 +1,186 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Fsck.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Consistency check of the persisted structures, with optional repair.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Fsck.h"
+#include "FRAM_BTree.h"
+#include "FRAM_Log.h"
+
+#define FRAM_FSCK_KIND_BTREE 0
+#define FRAM_FSCK_KIND_LOG 1
+#define FRAM_FSCK_KIND_CHECK 2
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+*/
+/**************************************************************************/
+FRAM_Fsck::FRAM_Fsck(void)
+{
+		_count = 0;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Registers a B+tree index, checked by FRAM_BTree::check()
+
+    @returns
+					0: success
+					16: FRAM_FSCK_STRUCTURES reached
+*/
+/**************************************************************************/
+byte FRAM_Fsck::add(FRAM_BTree *tree)
+{
+	return FRAM_Fsck::insert(FRAM_FSCK_KIND_BTREE, tree, NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Registers a binary log, checked by FRAM_Log::check()
+
+    @returns
+					0: success
+					16: FRAM_FSCK_STRUCTURES reached
+*/
+/**************************************************************************/
+byte FRAM_Fsck::add(FRAM_Log *log)
+{
+	return FRAM_Fsck::insert(FRAM_FSCK_KIND_LOG, log, NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Registers the check of an application structure
+
+    @params[in] check
+                Checks the structure, see FRAM_FsckCheck
+    @params[in] context
+                Passed to the check function
+    @returns
+					0: success
+					16: FRAM_FSCK_STRUCTURES reached
+*/
+/**************************************************************************/
+byte FRAM_Fsck::add(FRAM_FsckCheck check, void *context)
+{
+	return FRAM_Fsck::insert(FRAM_FSCK_KIND_CHECK, context, check);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the structures in the order of registration. Each one is
+				read back by bursts, a structure found inconsistent does not
+				stop the check of the next ones. Structures on several chips
+				are checked one chip after the other, the bus being blocking.
+
+    @params[in] repair
+                true to repair what can be, false to only report
+    @params[out] *report
+                Inconsistencies found, handler and context set by the caller
+    @returns
+					0: all structures consistent, or repaired
+					12: inconsistencies left, see report
+					other: first error code returned by a check
+*/
+/**************************************************************************/
+byte FRAM_Fsck::run(boolean repair, FRAM_FsckReport *report)
+{
+	FRAM_Fsck::start(report);
+	uint32_t begin = micros();
+	byte result = ERROR_0;
+	byte check;
+
+	for (uint8_t i = 0; i < _count; i++) {
+		switch (_kind[i]) {
+			case FRAM_FSCK_KIND_BTREE:
+				check = ((FRAM_BTree *) _structure[i])->check(report, repair);
+				break;
+			case FRAM_FSCK_KIND_LOG:
+				check = ((FRAM_Log *) _structure[i])->check(report, repair);
+				break;
+			default:
+				check = _check[i](_structure[i], report, repair);
+				break;
+		}
+		if (result == ERROR_0) result = check;
+	}
+	report->elapsed = micros() - begin;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records an inconsistency, called by the structure checks
+
+    @params[out] *report
+                The report of the check
+    @params[in] framAddr
+                Address of the inconsistent header, node or record
+    @params[in] problem
+                FRAM_FSCK_HEADER, _JOURNAL, _NODE, _ORDER, _LINK, _COUNT, _LEAK or _CHAIN
+    @params[in] repaired
+                true when the inconsistency has been repaired
+*/
+/**************************************************************************/
+void FRAM_Fsck::problem(FRAM_FsckReport *report, uint16_t framAddr, uint8_t problem, boolean repaired)
+{
+	if (report->problems == 0) report->firstProblem = framAddr;
+	report->problems++;
+	if (repaired) report->repaired++;
+	if (report->handler != NULL) report->handler(framAddr, problem, repaired, report->context);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clears the counters of a report, the handler is kept
+*/
+/**************************************************************************/
+void FRAM_Fsck::start(FRAM_FsckReport *report)
+{
+	report->problems = 0;
+	report->repaired = 0;
+	report->firstProblem = 0;
+	report->elapsed = 0;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Appends a structure to the list
+
+    @returns
+					0: success
+					16: FRAM_FSCK_STRUCTURES reached
+*/
+/**************************************************************************/
+byte FRAM_Fsck::insert(uint8_t kind, void *structure, FRAM_FsckCheck check)
+{
+	if (_count == FRAM_FSCK_STRUCTURES) return ERROR_16;
+
+	_kind[_count] = kind;
+	_structure[_count] = structure;
+	_check[_count] = check;
+	_count++;
+	return ERROR_0;
+}
@@ -0,0 +1,121 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Fsck.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Consistency check of the structures persisted by the library: headers,
+	journals, B+tree nodes and log record chains are read back by bursts and
+	checked against each other. Inconsistencies are reported, and repaired
+	when asked and possible.
+
+	There is no file system on the chip: the role of a superblock is played
+	by the header of each structure (magic, layout, counters), the allocator
+	metadata by the B+tree node count (nodes past it are free, nodes below it
+	must be reachable) and by the log head and tail. Both are checked
+	against what the walk finds.
+
+	Built-in checks cover FRAM_BTree and FRAM_Log only. FRAM_Heap,
+	FRAM_UndoLog, FRAM_ColumnTable, FRAM_Staging and FRAM_Checkpoint
+	validate their header, CRCs and copies and recover when opened (begin(),
+	resume() or restore()), FRAM_VersionStore checks the record pointer and
+	stamps on each read. To make them part of a run, register a function
+	calling the opening function with add(check, context).
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_FSCK_H_
+#define _FRAM_FSCK_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+#ifndef FRAM_FSCK_STRUCTURES
+#define FRAM_FSCK_STRUCTURES 8
+#endif
+
+// Inconsistencies reported
+#define FRAM_FSCK_HEADER 1		// bad magic, other layout or counter out of range
+#define FRAM_FSCK_JOURNAL 2		// modification left in the journal by a power loss
+#define FRAM_FSCK_NODE 3		// node of a bad type or entry count
+#define FRAM_FSCK_ORDER 4		// keys out of order or out of the separators of the parent
+#define FRAM_FSCK_LINK 5		// child or next leaf pointer out of range, shared or crossed
+#define FRAM_FSCK_COUNT 6		// entry count of the header different from the entries found
+#define FRAM_FSCK_LEAK 7		// allocated nodes not reachable from the root
+#define FRAM_FSCK_CHAIN 8		// log record length breaking the chain
+
+// Called for each inconsistency found
+typedef void (*FRAM_FsckHandler)(uint16_t framAddr, uint8_t problem, boolean repaired, void *context);
+
+struct FRAM_FsckReport {
+	FRAM_FsckHandler	handler;	// optional, set by the caller
+	void	*context;				// passed to the handler
+	uint16_t	problems;			// inconsistencies found
+	uint16_t	repaired;			// inconsistencies repaired
+	uint16_t	firstProblem;		// address of the first inconsistency
+	uint32_t	elapsed;			// duration in microseconds
+};
+
+/*
+	Check of an application structure, reports its inconsistencies with
+	FRAM_Fsck::problem() and repairs them when asked. Returns 0 when the
+	structure is consistent or repaired, 12 when inconsistencies are left,
+	or a bus error code.
+*/
+typedef byte (*FRAM_FsckCheck)(void *context, FRAM_FsckReport *report, boolean repair);
+
+class FRAM_BTree;
+class FRAM_Log;
+
+class FRAM_Fsck {
+ public:
+	FRAM_Fsck(void);
+
+	byte	add(FRAM_BTree *tree);
+	byte	add(FRAM_Log *log);
+	byte	add(FRAM_FsckCheck check, void *context);
+	byte	run(boolean repair, FRAM_FsckReport *report);
+
+	static void	problem(FRAM_FsckReport *report, uint16_t framAddr, uint8_t problem, boolean repaired);
+	static void	start(FRAM_FsckReport *report);
+
+ private:
+	uint8_t	_count;
+	uint8_t	_kind[FRAM_FSCK_STRUCTURES];
+	void	*_structure[FRAM_FSCK_STRUCTURES];
+	FRAM_FsckCheck	_check[FRAM_FSCK_STRUCTURES];
+
+	byte	insert(uint8_t kind, void *structure, FRAM_FsckCheck check);
+};
+
+#endif
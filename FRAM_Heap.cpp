@@ -0,0 +1,515 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Heap.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Persistent binary min-heap with journaled sift batches.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Heap.h"
+#include "FRAM_Image.h"
+#include "FRAM_BufferPool.h"
+
+#define FRAM_HEAP_SIZE_OFFSET 6
+#define FRAM_HEAP_RECORDS_OFFSET 3
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	Entries are a 4-byte key and payloadSize bytes. The first
+	FRAM_HEAP_CACHE_SIZE / entry size entries are kept in RAM.
+*/
+/**************************************************************************/
+FRAM_Heap::FRAM_Heap(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint8_t payloadSize, uint16_t capacity)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_payloadSize = payloadSize;
+		_entrySize = 4 + payloadSize;
+		_capacity = capacity;
+		_size = 0;
+		_repaired = false;
+		_levels = 0;
+		for (uint32_t n = capacity; n != 0; n >>= 1) _levels++;
+		_cached = FRAM_HEAP_CACHE_SIZE / _entrySize;
+		if (_cached > capacity) _cached = capacity;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Creates an empty heap
+
+    @returns
+					0: success
+					8: capacity null
+					10: payload too large for FRAM_HEAP_BATCH_SIZE
+					11: area out of the memory map
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Heap::format(void)
+{
+	byte result = FRAM_Heap::checkLayout();
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_HEAP_HEADER_SIZE + 1] = {
+		'P', 'H', _payloadSize, 0, (uint8_t) _capacity, (uint8_t) (_capacity >> 8), 0, 0, 0
+	};
+	result = _fram->writeArray(_framAddr, FRAM_HEAP_HEADER_SIZE + 1, header);
+	if (result == ERROR_0) {
+		_size = 0;
+		_repaired = false;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens an existing heap: applies a pending journal, loads the
+				cached levels and checks the heap order over all entries with
+				sequential bursts. A heap out of order is rebuilt.
+
+    @returns
+					0: success, see wasRepaired()
+					8, 10, 11: see format()
+					12: no heap, other layout or size out of range
+					14: transfer buffer pool exhausted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Heap::begin(void)
+{
+	byte result = FRAM_Heap::checkLayout();
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_HEAP_HEADER_SIZE];
+	result = _fram->readArray(_framAddr, FRAM_HEAP_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+	if ((header[0] != 'P') || (header[1] != 'H') || (header[2] != _payloadSize)) return ERROR_12;
+	if ((header[4] | ((uint16_t) header[5] << 8)) != _capacity) return ERROR_12;
+
+	_repaired = false;
+	_size = header[FRAM_HEAP_SIZE_OFFSET] | ((uint16_t) header[FRAM_HEAP_SIZE_OFFSET + 1] << 8);
+
+	uint8_t count;
+	result = _fram->readByte(FRAM_Heap::journalAddr(), &count);
+	if (result != ERROR_0) return result;
+	if (count != 0) {
+		uint16_t len = FRAM_HEAP_JOURNAL_OVERHEAD + count * (2 + _entrySize);
+		boolean valid = (count <= _levels) && (len <= FRAM_HEAP_BATCH_SIZE);
+		if (valid) {
+			result = _fram->readBlock(FRAM_Heap::journalAddr(), len, _batch);
+			if (result != ERROR_0) return result;
+			valid = FRAM_Heap::load32(_batch + len - 4) == FRAM_Image::crc32Update(0, _batch, len - 4);
+		}
+		// a torn journal was never applied: the heap is as before the operation
+		if (valid) result = FRAM_Heap::apply();
+		else result = _fram->writeByte(FRAM_Heap::journalAddr(), 0);
+		if (result != ERROR_0) return result;
+	}
+	if (_size > _capacity) return ERROR_12;
+
+	if (_cached != 0) {
+		result = _fram->readBlock(FRAM_Heap::entryAddr(0), _cached * _entrySize, _cache);
+		if (result != ERROR_0) return result;
+	}
+
+	boolean valid;
+	result = FRAM_Heap::validate(&valid);
+	if ((result != ERROR_0) || valid) return result;
+
+	// Floyd's construction, one journaled sift per internal entry
+	_repaired = true;
+	for (uint16_t i = _size / 2; (i > 0) && (result == ERROR_0); i--) {
+		_batch[0] = 0;
+		result = FRAM_Heap::siftDown(i - 1, i - 1, _size);
+		if (result == ERROR_0) result = FRAM_Heap::commit(_size);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Inserts an entry. Parents greater than the key are moved down the
+				path in RAM, then written with the new entry as one batch.
+
+    @params[in] key
+                The priority, the smallest is popped first
+    @params[in] payload[]
+                The payload size bytes of the entry
+    @returns
+					0: success
+					16: heap full
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Heap::push(uint32_t key, const uint8_t payload[])
+{
+	if (_size >= _capacity) return ERROR_16;
+
+	uint16_t hole = _size;
+	uint16_t parent;
+	uint32_t parentKey;
+	byte result = ERROR_0;
+
+	_batch[0] = 0;
+	while (hole > 0) {
+		parent = (hole - 1) / 2;
+		result = FRAM_Heap::readKey(parent, &parentKey);
+		if (result != ERROR_0) return result;
+		if (parentKey <= key) break;
+		result = FRAM_Heap::readEntry(parent, FRAM_Heap::addRecord(hole));
+		if (result != ERROR_0) return result;
+		hole = parent;
+	}
+	uint8_t *entry = FRAM_Heap::addRecord(hole);
+	FRAM_Heap::store32(entry, key);
+	if (_payloadSize != 0) memcpy(entry + 4, payload, _payloadSize);
+	return FRAM_Heap::commit(_size + 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Removes the entry of smallest key. The last entry is sifted down
+				from the root in RAM, the moved entries written as one batch.
+
+    @params[out] *key
+                The key of the entry
+    @params[out] payload[]
+                The payload size bytes of the entry
+    @returns
+					0: success
+					15: heap empty
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Heap::pop(uint32_t *key, uint8_t payload[])
+{
+	byte result = FRAM_Heap::peek(key, payload);
+	if (result != ERROR_0) return result;
+
+	_batch[0] = 0;
+	if (_size > 1) {
+		result = FRAM_Heap::siftDown(0, _size - 1, _size - 1);
+		if (result != ERROR_0) return result;
+	}
+	return FRAM_Heap::commit(_size - 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Entry of smallest key, left in the heap
+
+    @returns
+					0: success
+					15: heap empty
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Heap::peek(uint32_t *key, uint8_t payload[])
+{
+	if (_size == 0) return ERROR_15;
+
+	uint8_t root[4];
+	byte result;
+	if (_cached != 0) {
+		memcpy(root, _cache, 4);
+		if (_payloadSize != 0) memcpy(payload, _cache + 4, _payloadSize);
+	}
+	else {
+		result = _fram->readArray(FRAM_Heap::entryAddr(0), 4, root);
+		if ((result == ERROR_0) && (_payloadSize != 0)) result = _fram->readBlock(FRAM_Heap::entryAddr(0) + 4, _payloadSize, payload);
+		if (result != ERROR_0) return result;
+	}
+	*key = FRAM_Heap::load32(root);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of entries
+*/
+/**************************************************************************/
+uint16_t FRAM_Heap::getSize(void)
+{
+	return _size;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Maximum number of entries
+*/
+/**************************************************************************/
+uint16_t FRAM_Heap::getCapacity(void)
+{
+	return _capacity;
+}
+
+/**************************************************************************/
+/*!
+    @brief  true if begin() found the heap out of order and rebuilt it
+*/
+/**************************************************************************/
+boolean FRAM_Heap::wasRepaired(void)
+{
+	return _repaired;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes used on the chip: header, journal and entries
+*/
+/**************************************************************************/
+uint32_t FRAM_Heap::getAreaSize(void)
+{
+	return FRAM_HEAP_HEADER_SIZE + FRAM_HEAP_JOURNAL_OVERHEAD + (uint32_t) _levels * (2 + _entrySize) + (uint32_t) _capacity * _entrySize;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Checks the capacity, the journal size and the memory map
+*/
+/**************************************************************************/
+byte FRAM_Heap::checkLayout(void)
+{
+	if (_capacity == 0) return ERROR_8;
+	if ((FRAM_HEAP_JOURNAL_OVERHEAD + (uint32_t) _levels * (2 + _entrySize)) > FRAM_HEAP_BATCH_SIZE) return ERROR_10;
+	if (((uint32_t) _framAddr + FRAM_Heap::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of the journal
+*/
+/**************************************************************************/
+uint16_t FRAM_Heap::journalAddr(void)
+{
+	return _framAddr + FRAM_HEAP_HEADER_SIZE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of an entry
+*/
+/**************************************************************************/
+uint16_t FRAM_Heap::entryAddr(uint16_t index)
+{
+	return FRAM_Heap::journalAddr() + FRAM_HEAP_JOURNAL_OVERHEAD + _levels * (2 + _entrySize) + (uint16_t) ((uint32_t) index * _entrySize);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads an entry, from the cache for the top levels
+*/
+/**************************************************************************/
+byte FRAM_Heap::readEntry(uint16_t index, uint8_t entry[])
+{
+	if (index < _cached) {
+		memcpy(entry, _cache + index * _entrySize, _entrySize);
+		return ERROR_0;
+	}
+	return _fram->readBlock(FRAM_Heap::entryAddr(index), _entrySize, entry);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the key of an entry, from the cache for the top levels
+*/
+/**************************************************************************/
+byte FRAM_Heap::readKey(uint16_t index, uint32_t *key)
+{
+	uint8_t bytes[4];
+	byte result = ERROR_0;
+	if (index < _cached) memcpy(bytes, _cache + index * _entrySize, 4);
+	else result = _fram->readArray(FRAM_Heap::entryAddr(index), 4, bytes);
+	*key = FRAM_Heap::load32(bytes);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Key of an entry through a window of consecutive entries read
+				with one burst, for scans going up the indexes
+
+    @params[in] window[]
+                A pool buffer
+    @params[in,out] *first
+                Index of the first entry held by the window
+    @params[in,out] *count
+                Number of entries held, 0 to start
+*/
+/**************************************************************************/
+byte FRAM_Heap::windowKey(uint8_t window[], uint16_t *first, uint16_t *count, uint16_t index, uint32_t *key)
+{
+	uint16_t fit = FRAM_POOL_BUFFER_SIZE / _entrySize;
+	if ((index < _cached) || (fit == 0)) return FRAM_Heap::readKey(index, key);
+
+	if ((*count == 0) || (index < *first) || (index >= (*first + *count))) {
+		*first = index;
+		*count = ((_size - index) < fit) ? (_size - index) : fit;
+		byte result = _fram->readBlock(FRAM_Heap::entryAddr(index), *count * _entrySize, window);
+		if (result != ERROR_0) {
+			*count = 0;
+			return result;
+		}
+	}
+	*key = FRAM_Heap::load32(window + (index - *first) * _entrySize);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Adds a record to the journal in RAM, returns where its entry goes
+*/
+/**************************************************************************/
+uint8_t *FRAM_Heap::addRecord(uint16_t index)
+{
+	uint8_t *record = _batch + FRAM_HEAP_RECORDS_OFFSET + _batch[0] * (2 + _entrySize);
+	record[0] = (uint8_t) index;
+	record[1] = (uint8_t) (index >> 8);
+	_batch[0]++;
+	return record + 2;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Journals the sift of the entry at index last down from hole,
+				over the first size entries. Smaller children move up.
+*/
+/**************************************************************************/
+byte FRAM_Heap::siftDown(uint16_t hole, uint16_t last, uint16_t size)
+{
+	uint32_t key, childKey, rightKey;
+	uint32_t child;
+	byte result = FRAM_Heap::readKey(last, &key);
+
+	while ((result == ERROR_0) && ((child = 2UL * hole + 1) < size)) {
+		result = FRAM_Heap::readKey(child, &childKey);
+		if ((result == ERROR_0) && ((child + 1) < size)) {
+			result = FRAM_Heap::readKey(child + 1, &rightKey);
+			if (rightKey < childKey) {
+				child++;
+				childKey = rightKey;
+			}
+		}
+		if ((result != ERROR_0) || (childKey >= key)) break;
+		result = FRAM_Heap::readEntry(child, FRAM_Heap::addRecord(hole));
+		hole = child;
+	}
+	if (result == ERROR_0) result = FRAM_Heap::readEntry(last, FRAM_Heap::addRecord(hole));
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the journal in RAM with one burst, then applies it
+*/
+/**************************************************************************/
+byte FRAM_Heap::commit(uint16_t size)
+{
+	uint16_t len = FRAM_HEAP_RECORDS_OFFSET + _batch[0] * (2 + _entrySize);
+	_batch[1] = (uint8_t) size;
+	_batch[2] = (uint8_t) (size >> 8);
+	FRAM_Heap::store32(_batch + len, FRAM_Image::crc32Update(0, _batch, len));
+
+	byte result = _fram->writeBlock(FRAM_Heap::journalAddr(), len + 4, _batch);
+	if (result == ERROR_0) result = FRAM_Heap::apply();
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the journal records to their entries and the cache, the
+				new size to the header, then clears the journal
+*/
+/**************************************************************************/
+byte FRAM_Heap::apply(void)
+{
+	uint8_t *record = _batch + FRAM_HEAP_RECORDS_OFFSET;
+	uint16_t index;
+	byte result = ERROR_0;
+
+	for (uint8_t i = 0; (i < _batch[0]) && (result == ERROR_0); i++) {
+		index = record[0] | ((uint16_t) record[1] << 8);
+		if (index >= _capacity) return ERROR_12;
+		result = _fram->writeBlock(FRAM_Heap::entryAddr(index), _entrySize, record + 2);
+		if (index < _cached) memcpy(_cache + index * _entrySize, record + 2, _entrySize);
+		record += 2 + _entrySize;
+	}
+	if (result == ERROR_0) result = _fram->writeArray(_framAddr + FRAM_HEAP_SIZE_OFFSET, 2, _batch + 1);
+	if (result == ERROR_0) result = _fram->writeByte(FRAM_Heap::journalAddr(), 0);
+	if (result == ERROR_0) _size = _batch[1] | ((uint16_t) _batch[2] << 8);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the heap order, parents and children being read by two
+				windows moving up the entries
+*/
+/**************************************************************************/
+byte FRAM_Heap::validate(boolean *valid)
+{
+	*valid = true;
+	if (_size < 2) return ERROR_0;
+
+	FRAM_PoolBuffer parentPool;
+	FRAM_PoolBuffer childPool;
+	if ((parentPool.data == NULL) || (childPool.data == NULL)) return ERROR_14;
+
+	uint16_t parentFirst = 0, parentCount = 0, childFirst = 0, childCount = 0;
+	uint32_t parentKey = 0, childKey;
+	byte result = ERROR_0;
+
+	for (uint16_t i = 1; (i < _size) && (result == ERROR_0); i++) {
+		if (i & 1) result = FRAM_Heap::windowKey(parentPool.data, &parentFirst, &parentCount, (i - 1) / 2, &parentKey);
+		if (result == ERROR_0) result = FRAM_Heap::windowKey(childPool.data, &childFirst, &childCount, i, &childKey);
+		if ((result == ERROR_0) && (childKey < parentKey)) {
+			*valid = false;
+			break;
+		}
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Little endian word load
+*/
+/**************************************************************************/
+uint32_t FRAM_Heap::load32(const uint8_t *bytes)
+{
+	return bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Little endian word store
+*/
+/**************************************************************************/
+void FRAM_Heap::store32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
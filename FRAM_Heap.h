@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Heap.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Persistent binary min-heap (priority queue) of fixed size entries. The
+	top levels are cached in RAM, each operation computes its sift in RAM and
+	writes the moved entries as one journaled batch. The size and the heap
+	order are checked, and repaired if needed, at boot.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_HEAP_H_
+#define _FRAM_HEAP_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// RAM copy of the first entries, the top levels of the heap
+#ifndef FRAM_HEAP_CACHE_SIZE
+#define FRAM_HEAP_CACHE_SIZE 128
+#endif
+
+// RAM journal of one operation: one record per level of the heap
+#ifndef FRAM_HEAP_BATCH_SIZE
+#define FRAM_HEAP_BATCH_SIZE 192
+#endif
+
+#define FRAM_HEAP_HEADER_SIZE 8
+#define FRAM_HEAP_JOURNAL_OVERHEAD 7
+
+/*
+	Area layout
+		header		"PH", payload size, 0, capacity (2), size (2)
+		journal		record count (1), new size (2), records, CRC32 (4)
+					a record is an entry index (2) and the entry written there
+		entries		key (4) and payload, capacity entries
+
+	The smallest key is at index 0, the children of entry i are 2i + 1 and
+	2i + 2. An operation writes its journal with one burst, applies it, then
+	clears the record count: a journal with a valid CRC32 is applied again
+	at boot.
+*/
+
+class FRAM_Heap {
+ public:
+	FRAM_Heap(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint8_t payloadSize, uint16_t capacity);
+
+	byte	format(void);
+	byte	begin(void);
+	byte	push(uint32_t key, const uint8_t payload[]);
+	byte	pop(uint32_t *key, uint8_t payload[]);
+	byte	peek(uint32_t *key, uint8_t payload[]);
+	uint16_t	getSize(void);
+	uint16_t	getCapacity(void);
+	boolean	wasRepaired(void);
+	uint32_t	getAreaSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint8_t	_payloadSize;
+	uint8_t	_entrySize;
+	uint16_t	_capacity;
+	uint16_t	_size;
+	uint8_t	_levels;
+	uint16_t	_cached;
+	boolean	_repaired;
+	uint8_t	_cache[FRAM_HEAP_CACHE_SIZE];
+	uint8_t	_batch[FRAM_HEAP_BATCH_SIZE];
+
+	byte	checkLayout(void);
+	uint16_t	journalAddr(void);
+	uint16_t	entryAddr(uint16_t index);
+	byte	readEntry(uint16_t index, uint8_t entry[]);
+	byte	readKey(uint16_t index, uint32_t *key);
+	byte	windowKey(uint8_t window[], uint16_t *first, uint16_t *count, uint16_t index, uint32_t *key);
+	uint8_t	*addRecord(uint16_t index);
+	byte	siftDown(uint16_t hole, uint16_t last, uint16_t size);
+	byte	commit(uint16_t size);
+	byte	apply(void);
+	byte	validate(boolean *valid);
+	static uint32_t	load32(const uint8_t *bytes);
+	static void	store32(uint8_t *bytes, uint32_t value);
+};
+
+#endif
@@ -0,0 +1,311 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Image.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Dump and restore of memory images with sparse runs and CRC32 check.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Image.h"
+#include "FRAM_BufferPool.h"
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Dumps the whole memory map of a chip to a stream
+
+    @params[in] fram
+                The FRAM chip to dump
+    @params[in] out
+                The stream receiving the image
+    @returns
+				see dump(fram, out, framAddr, len)
+*/
+/**************************************************************************/
+byte FRAM_Image::dump(FRAM_MB85RC_I2C *fram, Stream &out)
+{
+	return FRAM_Image::dump(fram, out, 0, fram->getMaxAddress());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Dumps a memory area to a stream. The area is read twice by
+			maximal bursts: once for the CRC of the header, once for the records.
+
+    @params[in] fram
+                The FRAM chip to dump
+    @params[in] out
+                The stream receiving the image
+    @params[in] framAddr
+                The 16-bit address of the first byte to dump
+    @params[in] len
+                The number of bytes to dump
+    @returns
+				0: success
+				8: length null
+				11: memory area out of range
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Image::dump(FRAM_MB85RC_I2C *fram, Stream &out, uint16_t framAddr, uint32_t len)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len - 1) >= fram->getMaxAddress()) return ERROR_11;
+
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	uint32_t crc;
+	byte result = FRAM_Image::crc32(fram, framAddr, len, &crc);
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_IMAGE_HEADER_SIZE] = {
+		'F', 'R', 'I', 'M', FRAM_IMAGE_VERSION, 0,
+		(uint8_t) framAddr, (uint8_t) (framAddr >> 8),
+		(uint8_t) len, (uint8_t) (len >> 8), (uint8_t) (len >> 16), (uint8_t) (len >> 24),
+		(uint8_t) crc, (uint8_t) (crc >> 8), (uint8_t) (crc >> 16), (uint8_t) (crc >> 24)
+	};
+	out.write(header, FRAM_IMAGE_HEADER_SIZE);
+
+	uint8_t runType = 0;
+	uint32_t runCount = 0;
+	uint32_t offset = 0;
+	byte chunk, i;
+	uint8_t type;
+
+	while ((offset < len) && (result == ERROR_0)) {
+		chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		result = fram->readArray(framAddr + (uint16_t) offset, chunk, buffer);
+		if (result != ERROR_0) break;
+
+		type = FRAM_IMAGE_RAW;
+		if ((buffer[0] == 0x00) || (buffer[0] == 0xFF)) {
+			for (i = 1; (i < chunk) && (buffer[i] == buffer[0]); i++);
+			if (i == chunk) type = (buffer[0] == 0x00) ? FRAM_IMAGE_ZEROS : FRAM_IMAGE_ONES;
+		}
+
+		if ((runCount != 0) && (type != runType)) {
+			FRAM_Image::writeRun(out, runType, runCount);
+			runCount = 0;
+		}
+		if (type == FRAM_IMAGE_RAW) {
+			out.write((uint8_t) FRAM_IMAGE_RAW);
+			out.write(chunk);
+			out.write(buffer, chunk);
+		}
+		else {
+			runType = type;
+			runCount += chunk;
+		}
+		offset += chunk;
+	}
+
+	if (result == ERROR_0) {
+		if (runCount != 0) FRAM_Image::writeRun(out, runType, runCount);
+		out.write((uint8_t) FRAM_IMAGE_END);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restores an image from a stream to the chip at the address stored
+			in its header. Chunks already holding the right content are not
+			written again.
+			Chunks are written as they arrive, the CRC32 can only be checked
+			at the end: a truncated or corrupted image returns 12 with the
+			area partly written. Restore again from a good image, or restore
+			to a scratch chip first when the area must stay consistent.
+
+    @params[in] fram
+                The FRAM chip to restore
+    @params[in] in
+                The stream providing the image
+    @params[out] *written
+                Number of bytes actually written to the chip
+    @returns
+				0: success
+				11: image out of the chip memory range
+				12: bad header, truncated image or CRC mismatch
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Image::restore(FRAM_MB85RC_I2C *fram, Stream &in, uint32_t *written)
+{
+	uint8_t header[FRAM_IMAGE_HEADER_SIZE];
+	*written = 0;
+
+	if (in.readBytes(header, FRAM_IMAGE_HEADER_SIZE) != FRAM_IMAGE_HEADER_SIZE) return ERROR_12;
+	if ((header[0] != 'F') || (header[1] != 'R') || (header[2] != 'I') || (header[3] != 'M') || (header[4] != FRAM_IMAGE_VERSION)) return ERROR_12;
+
+	uint16_t framAddr = header[6] | ((uint16_t) header[7] << 8);
+	uint32_t len = header[8] | ((uint32_t) header[9] << 8) | ((uint32_t) header[10] << 16) | ((uint32_t) header[11] << 24);
+	uint32_t crc = header[12] | ((uint32_t) header[13] << 8) | ((uint32_t) header[14] << 16) | ((uint32_t) header[15] << 24);
+	if (len == 0) return ERROR_12;
+	if (((uint32_t) framAddr + len - 1) >= fram->getMaxAddress()) return ERROR_11;
+
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	uint8_t record[2];
+	uint32_t offset = 0;
+	uint32_t check = 0;
+	uint16_t count;
+	boolean run;
+	byte chunk;
+	byte result = ERROR_0;
+
+	while (result == ERROR_0) {
+		if (in.readBytes(record, 1) != 1) return ERROR_12;
+		if (record[0] == FRAM_IMAGE_END) break;
+
+		run = (record[0] != FRAM_IMAGE_RAW);
+		if (!run) {
+			if (in.readBytes(record, 1) != 1) return ERROR_12;
+			count = record[0];
+		}
+		else if ((record[0] == FRAM_IMAGE_ZEROS) || (record[0] == FRAM_IMAGE_ONES)) {
+			uint8_t value = (record[0] == FRAM_IMAGE_ZEROS) ? 0x00 : 0xFF;
+			if (in.readBytes(record, 2) != 2) return ERROR_12;
+			count = record[0] | ((uint16_t) record[1] << 8);
+			memset(buffer, value, FRAM_CHUNK_SIZE);
+		}
+		else {
+			return ERROR_12;
+		}
+		if ((count == 0) || ((offset + count) > len)) return ERROR_12;
+
+		// raw records may come from a platform with a larger chunk size
+		while ((count > 0) && (result == ERROR_0)) {
+			chunk = (count > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) count;
+			if (!run && (in.readBytes(buffer, chunk) != chunk)) return ERROR_12;
+			check = FRAM_Image::crc32Update(check, buffer, chunk);
+			result = FRAM_Image::restoreChunk(fram, framAddr + (uint16_t) offset, chunk, buffer, written);
+			offset += chunk;
+			count -= chunk;
+		}
+	}
+
+	if ((result == ERROR_0) && ((offset != len) || (check != crc))) result = ERROR_12;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes the CRC32 (IEEE 802.3) of a memory area read by maximal bursts
+
+    @params[in] fram
+                The FRAM chip to read
+    @params[in] framAddr
+                The 16-bit address of the first byte
+    @params[in] len
+                The number of bytes
+    @params[out] *crc
+                CRC32 of the memory area
+    @returns
+				0: success
+				8: length null
+				11: memory area out of range
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Image::crc32(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint32_t *crc)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len - 1) >= fram->getMaxAddress()) return ERROR_11;
+
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	uint32_t offset = 0;
+	byte chunk;
+	byte result = ERROR_0;
+
+	*crc = 0;
+	while ((offset < len) && (result == ERROR_0)) {
+		chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		result = fram->readArray(framAddr + (uint16_t) offset, chunk, buffer);
+		*crc = FRAM_Image::crc32Update(*crc, buffer, chunk);
+		offset += chunk;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Updates a CRC32 (IEEE 802.3) with a buffer. Table-less to spare RAM.
+
+    @params[in] crc
+                CRC of the previous data, 0 for the first call
+    @params[in] data
+                The bytes to add
+    @params[in] len
+                The number of bytes
+    @returns
+				CRC32 including the buffer
+*/
+/**************************************************************************/
+uint32_t FRAM_Image::crc32Update(uint32_t crc, const uint8_t *data, uint16_t len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *data++;
+		for (uint8_t k = 0; k < 8; k++) {
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Writes a run record, split in several records above 65535 bytes
+*/
+/**************************************************************************/
+void FRAM_Image::writeRun(Stream &out, uint8_t type, uint32_t count)
+{
+	uint16_t n;
+	while (count > 0) {
+		n = (count > 0xFFFF) ? 0xFFFF : (uint16_t) count;
+		out.write(type);
+		out.write((uint8_t) n);
+		out.write((uint8_t) (n >> 8));
+		count -= n;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a chunk only if the chip content differs
+
+    @params[out] *written
+                Incremented by the number of bytes written
+    @returns
+				return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Image::restoreChunk(FRAM_MB85RC_I2C *fram, uint16_t framAddr, byte items, uint8_t values[], uint32_t *written)
+{
+	FRAM_PoolBuffer currentPool;
+	if (currentPool.data == NULL) return ERROR_14;
+	uint8_t *current = currentPool.data;
+	byte result = fram->readArray(framAddr, items, current);
+	if ((result == ERROR_0) && (memcmp(current, values, items) != 0)) {
+		result = fram->writeArray(framAddr, items, values);
+		if (result == ERROR_0) *written += items;
+	}
+	return result;
+}
@@ -0,0 +1,87 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Image.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Dump and restore of memory images over any Arduino Stream (Serial, SD file...).
+	Runs of 0x00 and 0xFF are stored sparsely and the header carries a CRC32 of
+	the whole image. Restore only writes the chunks which differ from the chip.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_IMAGE_H_
+#define _FRAM_IMAGE_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+/*
+	Image format - multi-bytes values are little endian
+
+	Header, 16 bytes
+		4 bytes		magic "FRIM"
+		1 byte		format version
+		1 byte		reserved, 0
+		2 bytes		start address of the image in the chip
+		4 bytes		length of the image in bytes
+		4 bytes		CRC32 of the image content (IEEE 802.3)
+
+	Records, until the end record
+		'R' + 1 byte count + count bytes	raw data
+		'Z' + 2 bytes count					run of 0x00
+		'F' + 2 bytes count					run of 0xFF
+		'E'									end of image
+*/
+#define FRAM_IMAGE_VERSION 1
+#define FRAM_IMAGE_HEADER_SIZE 16
+#define FRAM_IMAGE_RAW 'R'
+#define FRAM_IMAGE_ZEROS 'Z'
+#define FRAM_IMAGE_ONES 'F'
+#define FRAM_IMAGE_END 'E'
+
+
+class FRAM_Image {
+ public:
+	static byte	dump(FRAM_MB85RC_I2C *fram, Stream &out);
+	static byte	dump(FRAM_MB85RC_I2C *fram, Stream &out, uint16_t framAddr, uint32_t len);
+	static byte	restore(FRAM_MB85RC_I2C *fram, Stream &in, uint32_t *written);
+	static byte	crc32(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint32_t *crc);
+	static uint32_t	crc32Update(uint32_t crc, const uint8_t *data, uint16_t len);
+
+ private:
+	static void	writeRun(Stream &out, uint8_t type, uint32_t count);
+	static byte	restoreChunk(FRAM_MB85RC_I2C *fram, uint16_t framAddr, byte items, uint8_t values[], uint32_t *written);
+};
+
+#endif
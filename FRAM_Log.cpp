@@ -0,0 +1,471 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Log.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Deferred formatting binary log in a circular area.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Log.h"
+
+#define FRAM_LOG_END 0x00
+#define FRAM_LOG_WRAP 0xFF
+#define FRAM_LOG_ARGS_OFFSET (1 + FRAM_LOG_ID_SIZE)
+
+#if FRAM_LOG_MAX_RECORD > 254
+#error "FRAM_LOG_MAX_RECORD must stay below the wrap marker 0xFF"
+#endif
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	size is the number of bytes of the log area, header included
+*/
+/**************************************************************************/
+FRAM_Log::FRAM_Log(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_size = size;
+		_head = 0;
+		_tail = 0;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Empties the log and writes its header
+
+    @returns
+					0: success
+					11: area out of the memory map
+					16: area too small to hold a record
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Log::format(void)
+{
+	if (_size < (FRAM_LOG_HEADER_SIZE + FRAM_LOG_ARGS_OFFSET + 1)) return ERROR_16;
+	if (((uint32_t) _framAddr + _size) > _fram->getMaxAddress()) return ERROR_11;
+
+	uint8_t header[FRAM_LOG_HEADER_SIZE + 1] = { 'D', 'L', sizeof(int), sizeof(long), 0, 0, FRAM_LOG_END };
+	_head = 0;
+	_tail = 0;
+	return _fram->writeArray(_framAddr, FRAM_LOG_HEADER_SIZE + 1, header);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Opens an existing log: reads the oldest record offset and walks
+				the record lengths up to the end marker, see walk()
+
+    @returns
+					0: success
+					12: no log header, log written by another platform or broken chain
+					16: area too small to hold a record
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Log::begin(void)
+{
+	if (_size < (FRAM_LOG_HEADER_SIZE + FRAM_LOG_ARGS_OFFSET + 1)) return ERROR_16;
+
+	uint8_t header[FRAM_LOG_HEADER_SIZE];
+	byte result = _fram->readArray(_framAddr, FRAM_LOG_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+	if ((header[0] != 'D') || (header[1] != 'L') || (header[2] != sizeof(int)) || (header[3] != sizeof(long))) return ERROR_12;
+
+	uint16_t offset = header[4] | ((uint16_t) header[5] << 8);
+	if (offset >= (_size - FRAM_LOG_HEADER_SIZE)) return ERROR_12;
+	_tail = offset;
+
+	result = FRAM_Log::walk(&offset);
+	if (result == ERROR_0) _head = offset;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the log and opens it, may replace begin(). The record
+				chain is walked by bursts from the oldest record: each length
+				must be a record length, an end or a wrap marker, records must
+				stay in the area and, once wrapped, below the oldest record.
+				With repair, a broken chain is cut by an end marker at the
+				first bad length: the records before it are kept.
+
+    @params[out] *report
+                Inconsistencies found, see FRAM_Fsck
+    @params[in] repair
+                true to repair what can be
+    @returns
+					0: log consistent, or repaired
+					12: inconsistencies left, see report
+					16: area too small to hold a record
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Log::check(FRAM_FsckReport *report, boolean repair)
+{
+	if (_size < (FRAM_LOG_HEADER_SIZE + FRAM_LOG_ARGS_OFFSET + 1)) return ERROR_16;
+
+	uint8_t header[FRAM_LOG_HEADER_SIZE];
+	byte result = _fram->readArray(_framAddr, FRAM_LOG_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+
+	uint16_t offset = header[4] | ((uint16_t) header[5] << 8);
+	if ((header[0] != 'D') || (header[1] != 'L') || (header[2] != sizeof(int)) || (header[3] != sizeof(long))
+		|| (offset >= (_size - FRAM_LOG_HEADER_SIZE))) {
+		FRAM_Fsck::problem(report, _framAddr, FRAM_FSCK_HEADER, false);
+		return ERROR_12;
+	}
+	_tail = offset;
+
+	result = FRAM_Log::walk(&offset);
+	if (result == ERROR_0) _head = offset;
+	if (result != ERROR_12) return result;
+
+	if (repair) {
+		result = _fram->writeByte(FRAM_Log::dataAddr(offset), FRAM_LOG_END);
+		if (result != ERROR_0) return result;
+		_head = offset;
+	}
+	FRAM_Fsck::problem(report, FRAM_Log::dataAddr(offset), FRAM_FSCK_CHAIN, repair);
+	return repair ? ERROR_0 : ERROR_12;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Appends a record of arguments already packed by the caller.
+				FRAM_LOG() packs them from the call arguments.
+
+    @params[in] id
+                The format identifier, see FRAM_LOG_ID()
+    @params[in] args[]
+                The argument bytes
+    @params[in] len
+                The number of argument bytes
+    @returns
+					see log()
+*/
+/**************************************************************************/
+byte FRAM_Log::append(uint32_t id, const uint8_t args[], uint8_t len)
+{
+	if (len > FRAM_LOG_MAX_ARGS) return ERROR_10;
+	memcpy(_record + FRAM_LOG_ARGS_OFFSET, args, len);
+	return FRAM_Log::store(id, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Bytes taken by the records
+*/
+/**************************************************************************/
+uint16_t FRAM_Log::getUsed(void)
+{
+	uint16_t data = _size - FRAM_LOG_HEADER_SIZE;
+	return (_head >= _tail) ? (_head - _tail) : (data - _tail + _head);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Size of the log area
+*/
+/**************************************************************************/
+uint16_t FRAM_Log::getSize(void)
+{
+	return _size;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Arguments stored with the C variadic promotions
+*/
+/**************************************************************************/
+void FRAM_Log::pack(uint8_t *len, bool value)
+{
+	int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, char value)
+{
+	int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, signed char value)
+{
+	int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, unsigned char value)
+{
+	int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, short value)
+{
+	int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, unsigned short value)
+{
+	unsigned int promoted = value;
+	FRAM_Log::packRaw(len, &promoted, sizeof(promoted));
+}
+
+void FRAM_Log::pack(uint8_t *len, int value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, unsigned int value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, long value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, unsigned long value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, long long value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, unsigned long long value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, float value)
+{
+	FRAM_Log::packRaw(len, &value, sizeof(value));
+}
+
+void FRAM_Log::pack(uint8_t *len, double value)
+{
+	float narrowed = (float) value;
+	FRAM_Log::packRaw(len, &narrowed, sizeof(narrowed));
+}
+
+void FRAM_Log::pack(uint8_t *len, const char *value)
+{
+	uint8_t chars = 0;
+	if (value != NULL) {
+		while ((chars < FRAM_LOG_MAX_STRING) && (value[chars] != 0)) chars++;
+	}
+	FRAM_Log::packRaw(len, &chars, 1);
+	FRAM_Log::packRaw(len, value, chars);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Copies argument bytes in the record. An overflow leaves len above
+				FRAM_LOG_MAX_ARGS so that store() rejects the record.
+*/
+/**************************************************************************/
+void FRAM_Log::packRaw(uint8_t *len, const void *value, uint8_t size)
+{
+	if (((uint16_t) *len + size) > FRAM_LOG_MAX_ARGS) {
+		*len = FRAM_LOG_MAX_ARGS + 1;
+		return;
+	}
+	memcpy(_record + FRAM_LOG_ARGS_OFFSET + *len, value, size);
+	*len += size;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Appends the record assembled in RAM. The oldest records covered
+				by the new one are dropped first, their new start saved in the
+				header. The record and the next end marker are written with one
+				burst, then the record is linked by writing its length over the
+				previous end marker, or the wrap marker when it goes back to the
+				start of the area: a power loss leaves the log as it was.
+
+    @params[in] id
+                The format identifier
+    @params[in] len
+                The number of argument bytes in the record
+    @returns
+					0: success
+					10: arguments larger than FRAM_LOG_MAX_ARGS
+					12: broken record chain
+					16: area too small for the record
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Log::store(uint32_t id, uint8_t len)
+{
+	if (len > FRAM_LOG_MAX_ARGS) return ERROR_10;
+
+	uint8_t size = FRAM_LOG_ARGS_OFFSET + len;
+	uint16_t data = _size - FRAM_LOG_HEADER_SIZE;
+	if (((uint16_t) size + 1) > data) return ERROR_16;
+
+	uint16_t start = (((uint32_t) _head + size + 1) > data) ? 0 : _head;
+	byte result = ERROR_0;
+	if ((start != _head) && (_head <= size)) {
+		// the record would cover its own wrap marker: the log restarts empty
+		result = _fram->writeByte(FRAM_Log::dataAddr(0), FRAM_LOG_END);
+		if (result == ERROR_0) result = FRAM_Log::writeTail(0);
+		if (result != ERROR_0) return result;
+		_head = 0;
+	}
+	result = FRAM_Log::evict(start, size);
+	if (result != ERROR_0) return result;
+
+	_record[0] = size;
+	_record[1] = (uint8_t) id;
+	_record[2] = (uint8_t) (id >> 8);
+	_record[3] = (uint8_t) (id >> 16);
+	_record[4] = (uint8_t) (id >> 24);
+	_record[size] = FRAM_LOG_END;
+
+	if (start != _head) {
+		result = _fram->writeBlock(FRAM_Log::dataAddr(start), size + 1, _record);
+		if (result == ERROR_0) result = _fram->writeByte(FRAM_Log::dataAddr(_head), FRAM_LOG_WRAP);
+	}
+	else {
+		result = _fram->writeBlock(FRAM_Log::dataAddr(start) + 1, size, _record + 1);
+		if (result == ERROR_0) result = _fram->writeByte(FRAM_Log::dataAddr(start), size);
+	}
+	if ((result == ERROR_0) && (_tail == _head) && (start != _head)) result = FRAM_Log::writeTail(start);
+	if (result == ERROR_0) _head = start + size;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drops the oldest records overlapping a record of size bytes at
+				start and its end marker, and saves the new oldest offset.
+				When all records are dropped, the oldest offset stays on the
+				current end marker until the new record is linked.
+*/
+/**************************************************************************/
+byte FRAM_Log::evict(uint16_t start, uint8_t size)
+{
+	uint16_t data = _size - FRAM_LOG_HEADER_SIZE;
+	uint16_t tail = _tail;
+	boolean wrap = (start != _head);
+	boolean covered;
+	uint8_t len;
+	byte result;
+
+	while (tail != _head) {
+		if (wrap) covered = (tail >= _head) || (tail <= size);
+		else covered = (tail >= _head) && (tail <= (_head + size));
+		if (!covered) break;
+
+		result = _fram->readByte(FRAM_Log::dataAddr(tail), &len);
+		if (result != ERROR_0) return result;
+		if (len == FRAM_LOG_END) return ERROR_12;
+		if (len == FRAM_LOG_WRAP) tail = 0;
+		else tail += len;
+		if (tail >= data) return ERROR_12;
+	}
+	if (tail == _tail) return ERROR_0;
+	return FRAM_Log::writeTail(tail);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Saves the offset of the oldest record in the header
+*/
+/**************************************************************************/
+byte FRAM_Log::writeTail(uint16_t tail)
+{
+	uint8_t offset[2] = { (uint8_t) tail, (uint8_t) (tail >> 8) };
+	byte result = _fram->writeArray(_framAddr + FRAM_LOG_HEADER_SIZE - 2, 2, offset);
+	if (result == ERROR_0) _tail = tail;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walks the record lengths from the oldest record up to the end
+				marker. The data area is read by windows of the record buffer
+				size: one burst covers the lengths of several records.
+
+    @params[out] *end
+                Offset of the end marker, or of the first bad length
+    @returns
+					0: success
+					12: broken chain at *end
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Log::walk(uint16_t *end)
+{
+	uint16_t data = _size - FRAM_LOG_HEADER_SIZE;
+	uint16_t offset = _tail;
+	uint16_t first = 0;
+	uint16_t next;
+	uint8_t count = 0;
+	uint8_t len;
+	boolean wrapped = false;
+	byte result;
+
+	while (true) {
+		*end = offset;
+		if ((offset < first) || (offset >= (first + count))) {
+			first = offset;
+			count = ((data - offset) > (uint16_t) sizeof(_record)) ? (uint8_t) sizeof(_record) : (uint8_t) (data - offset);
+			result = _fram->readBlock(FRAM_Log::dataAddr(first), count, _record);
+			if (result != ERROR_0) return result;
+		}
+
+		len = _record[offset - first];
+		if (len == FRAM_LOG_END) return ERROR_0;
+		if (len == FRAM_LOG_WRAP) {
+			if (wrapped) return ERROR_12;
+			wrapped = true;
+			next = 0;
+		}
+		else {
+			if ((len < FRAM_LOG_ARGS_OFFSET) || (len > FRAM_LOG_MAX_RECORD)) return ERROR_12;
+			next = offset + len;
+			if (next >= data) return ERROR_12;
+		}
+		// once wrapped, the records must end before the oldest one
+		if (wrapped && (next >= _tail)) return ERROR_12;
+		offset = next;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of an offset of the data area
+*/
+/**************************************************************************/
+uint16_t FRAM_Log::dataAddr(uint16_t offset)
+{
+	return _framAddr + FRAM_LOG_HEADER_SIZE + offset;
+}
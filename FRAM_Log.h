@@ -0,0 +1,149 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Log.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Deferred formatting binary log: a record holds a format identifier
+	computed at compile time and the raw bytes of the arguments, appended
+	with one burst to a circular area. Format strings never reach the chip,
+	they are expanded on the host by extras/python/fram_log.py.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_LOG_H_
+#define _FRAM_LOG_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_Fsck.h"
+
+// Largest record: length, format identifier and arguments
+#ifndef FRAM_LOG_MAX_RECORD
+#define FRAM_LOG_MAX_RECORD 48
+#endif
+
+// Longest string argument kept, longer ones are truncated
+#ifndef FRAM_LOG_MAX_STRING
+#define FRAM_LOG_MAX_STRING 16
+#endif
+
+#define FRAM_LOG_HEADER_SIZE 6
+#define FRAM_LOG_ID_SIZE 4
+#define FRAM_LOG_MAX_ARGS (FRAM_LOG_MAX_RECORD - 1 - FRAM_LOG_ID_SIZE)
+
+/*
+	Log layout
+		header		"DL", sizeof(int), sizeof(long), oldest record offset (2)
+		records		length (1), format identifier (4), arguments
+		end			a length of 0 follows the newest record, 0xFF sends
+					the reader back to the first data byte
+
+	Arguments are stored little endian with the C variadic promotions: char
+	and short as int, float and double as float. A string is stored as its
+	length (1) followed by its characters.
+	The format identifier is the 32-bit FNV-1a hash of the format string.
+*/
+
+class FRAM_Log {
+ public:
+	FRAM_Log(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size);
+
+	byte	format(void);
+	byte	begin(void);
+	byte	check(FRAM_FsckReport *report, boolean repair);
+	byte	append(uint32_t id, const uint8_t args[], uint8_t len);
+	uint16_t	getUsed(void);
+	uint16_t	getSize(void);
+
+	template<typename... Args> byte log(uint32_t id, Args... args)
+	{
+		uint8_t len = 0;
+		FRAM_Log::packAll(&len, args...);
+		return FRAM_Log::store(id, len);
+	}
+
+	static constexpr uint32_t formatId(const char *format, uint32_t hash = 2166136261UL)
+	{
+		return (*format == 0) ? hash : FRAM_Log::formatId(format + 1, (hash ^ (uint8_t) *format) * 16777619UL);
+	}
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint16_t	_size;
+	uint16_t	_head;
+	uint16_t	_tail;
+	uint8_t	_record[FRAM_LOG_MAX_RECORD + 1];
+
+	void	packAll(uint8_t *) {}
+	template<typename T, typename... Rest> void packAll(uint8_t *len, T value, Rest... rest)
+	{
+		FRAM_Log::pack(len, value);
+		FRAM_Log::packAll(len, rest...);
+	}
+
+	void	pack(uint8_t *len, bool value);
+	void	pack(uint8_t *len, char value);
+	void	pack(uint8_t *len, signed char value);
+	void	pack(uint8_t *len, unsigned char value);
+	void	pack(uint8_t *len, short value);
+	void	pack(uint8_t *len, unsigned short value);
+	void	pack(uint8_t *len, int value);
+	void	pack(uint8_t *len, unsigned int value);
+	void	pack(uint8_t *len, long value);
+	void	pack(uint8_t *len, unsigned long value);
+	void	pack(uint8_t *len, long long value);
+	void	pack(uint8_t *len, unsigned long long value);
+	void	pack(uint8_t *len, float value);
+	void	pack(uint8_t *len, double value);
+	void	pack(uint8_t *len, const char *value);
+	void	packRaw(uint8_t *len, const void *value, uint8_t size);
+	byte	store(uint32_t id, uint8_t len);
+	byte	evict(uint16_t start, uint8_t size);
+	byte	writeTail(uint16_t tail);
+	byte	walk(uint16_t *end);
+	uint16_t	dataAddr(uint16_t offset);
+};
+
+// Forces the hash of a format string to be computed at compile time
+template<uint32_t id> struct FRAM_LogFormat {
+	static const uint32_t value = id;
+};
+
+#define FRAM_LOG_ID(format) (FRAM_LogFormat<FRAM_Log::formatId(format)>::value)
+
+// FRAM_LOG(logger, "temp %d at %lu", t, millis()): only the identifier of the format is stored
+#define FRAM_LOG(logger, format, ...) (logger).log(FRAM_LOG_ID(format), ##__VA_ARGS__)
+
+#endif
@@ -22,7 +22,17 @@
 
 #include <stdlib.h>
 #include <Wire.h>
+#include <SPI.h>
 #include "FRAM_MB85RC_I2C.h"
+#include "FRAM_BufferPool.h"
+#include "FRAM_Watch.h"
+
+#if defined(FRAM_SIMULATOR_MMAP)
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
 
 /*========================================================================*/
 /*                            CONSTRUCTORS                                */
@@ -36,6 +46,12 @@
 FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(void) 
 {
 		_framInitialised = false;
+		_spiCsPin = -1;
+		_image = NULL;
+		_mapBase = NULL;
+		_mapLength = 0;
+		_watch = NULL;
+		_writeDepth = 0;
 		_manualMode = false;
 		i2c_addr = MB85RC_DEFAULT_ADDRESS;
 		wpPin = DEFAULT_WP_PIN;
@@ -46,6 +62,12 @@ FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(void)
 FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(uint8_t address, boolean wp) 
 {
 		_framInitialised = false;
+		_spiCsPin = -1;
+		_image = NULL;
+		_mapBase = NULL;
+		_mapLength = 0;
+		_watch = NULL;
+		_writeDepth = 0;
 		_manualMode = false;
 		i2c_addr = address;
 		wpPin = DEFAULT_WP_PIN;
@@ -55,6 +77,12 @@ FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(uint8_t address, boolean wp)
 FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(uint8_t address, boolean wp, int pin) 
 {
 		_framInitialised = false;
+		_spiCsPin = -1;
+		_image = NULL;
+		_mapBase = NULL;
+		_mapLength = 0;
+		_watch = NULL;
+		_writeDepth = 0;
 		_manualMode = false;
 		i2c_addr = address;
 		wpPin = pin;
@@ -66,6 +94,12 @@ FRAM_MB85RC_I2C::FRAM_MB85RC_I2C(uint8_t address, boolean wp, int pin, uint16_t
 {
 		//This constructor provides capability for chips without the device IDs implemented
 		_framInitialised = false;
+		_spiCsPin = -1;
+		_image = NULL;
+		_mapBase = NULL;
+		_mapLength = 0;
+		_watch = NULL;
+		_writeDepth = 0;
 		_manualMode = true;
 		i2c_addr = address;
 		wpPin = pin;
@@ -162,14 +196,26 @@ byte FRAM_MB85RC_I2C::checkDevice(void)
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::writeArray (uint16_t framAddr, byte items, uint8_t values[])
 {
-	if ((framAddr >= maxaddress) || ((framAddr + (uint16_t) items - 1) >= maxaddress)) return ERROR_11;
-	
+	if ((framAddr >= maxaddress) || (((uint32_t) framAddr + items - 1) >= maxaddress)) return ERROR_11;
 	
-	FRAM_MB85RC_I2C::I2CAddressAdapt(framAddr);
-	for (byte i=0; i < items ; i++) {
-		Wire.write(values[i]);
+	byte result = ERROR_0;
+	if (_image != NULL) {
+		// a write protected chip silently ignores writes
+		if (wpStatus) return ERROR_0;
+		memcpy(_image + framAddr, values, items);
+	}
+	else if (_spiCsPin >= 0) {
+		FRAM_MB85RC_I2C::SPIWrite(framAddr, items, values);
+	}
+	else {
+		FRAM_MB85RC_I2C::I2CAddressAdapt(framAddr);
+		for (byte i=0; i < items ; i++) {
+			Wire.write(values[i]);
+		}
+		result = Wire.endTransmission();
 	}
-	return Wire.endTransmission();
+	if (result == ERROR_0) FRAM_MB85RC_I2C::notifyWrite(framAddr, items);
+	return result;
 }
 
 /**************************************************************************/
@@ -189,8 +235,7 @@ byte FRAM_MB85RC_I2C::writeArray (uint16_t framAddr, byte items, uint8_t values[
 
 byte FRAM_MB85RC_I2C::writeByte (uint16_t framAddr, uint8_t value)
 {
-	uint8_t buffer[] = {value}; 
-	return FRAM_MB85RC_I2C::writeArray(framAddr, 1, buffer);
+	return FRAM_MB85RC_I2C::writeArray(framAddr, 1, &value);
 }
 
 
@@ -213,12 +258,20 @@ byte FRAM_MB85RC_I2C::writeByte (uint16_t framAddr, uint8_t value)
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::readArray (uint16_t framAddr, byte items, uint8_t values[])
 {
-	if ((framAddr >= maxaddress) || ((framAddr + (uint16_t) items - 1) >= maxaddress)) return ERROR_11;
+	if ((framAddr >= maxaddress) || (((uint32_t) framAddr + items - 1) >= maxaddress)) return ERROR_11;
 	
 	byte result;
 	if (items == 0) {
 		result = ERROR_8; //number of bytes asked to read null
 	}
+	else if (_image != NULL) {
+		memcpy(values, _image + framAddr, items);
+		result = ERROR_0;
+	}
+	else if (_spiCsPin >= 0) {
+		FRAM_MB85RC_I2C::SPIRead(framAddr, items, values);
+		result = ERROR_0;
+	}
 	else {
 		FRAM_MB85RC_I2C::I2CAddressAdapt(framAddr);
 		result = Wire.endTransmission();
@@ -231,6 +284,80 @@ byte FRAM_MB85RC_I2C::readArray (uint16_t framAddr, byte items, uint8_t values[]
 	return result;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Reads a block of bytes larger than the Wire buffer from the specified FRAM address
+			The block is read as consecutive bursts of FRAM_CHUNK_SIZE bytes
+			over I2C, of 255 bytes over SPI
+
+    @params[in] framAddr
+                The 16-bit address to read from in FRAM memory
+	@params[in] items
+				number of bytes to read from memory chip
+	@params[out] values[]
+				array to be filled in by the memory read
+    @returns    
+				return code of Wire.endTransmission() of the first failing burst
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::readBlock (uint16_t framAddr, uint16_t items, uint8_t values[])
+{
+	if (items == 0) return ERROR_8;
+	if (((uint32_t) framAddr + items - 1) >= maxaddress) return ERROR_11;
+	
+	byte result = ERROR_0;
+	byte burst = FRAM_MB85RC_I2C::maxBurst();
+	byte chunk;
+	while ((items > 0) && (result == ERROR_0)) {
+		chunk = (items > burst) ? burst : (byte) items;
+		result = FRAM_MB85RC_I2C::readArray(framAddr, chunk, values);
+		framAddr += chunk;
+		values += chunk;
+		items -= chunk;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a block of bytes larger than the Wire buffer to a specific address
+			The block is written as consecutive bursts of FRAM_CHUNK_SIZE bytes
+			over I2C, of 255 bytes over SPI
+
+    @params[in] framAddr
+                The 16-bit address to write to in FRAM memory
+    @params[in] items
+                The number of bytes to write from the array
+	@params[in] values[]
+                The array of bytes to write
+	@returns
+				return code of Wire.endTransmission() of the first failing burst
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::writeBlock (uint16_t framAddr, uint16_t items, uint8_t values[])
+{
+	if (items == 0) return ERROR_8;
+	if (((uint32_t) framAddr + items - 1) >= maxaddress) return ERROR_11;
+	
+	byte result = ERROR_0;
+	byte burst = FRAM_MB85RC_I2C::maxBurst();
+	byte chunk;
+	uint16_t start = framAddr;
+	uint32_t written = 0;
+	_writeDepth++;
+	while ((items > 0) && (result == ERROR_0)) {
+		chunk = (items > burst) ? burst : (byte) items;
+		result = FRAM_MB85RC_I2C::writeArray(framAddr, chunk, values);
+		if (result == ERROR_0) written += chunk;
+		framAddr += chunk;
+		values += chunk;
+		items -= chunk;
+	}
+	_writeDepth--;
+	FRAM_MB85RC_I2C::notifyWrite(start, written);
+	return result;
+}
+
 /**************************************************************************/
 /*!
     @brief  Reads one byte from the specified FRAM address
@@ -247,10 +374,7 @@ byte FRAM_MB85RC_I2C::readArray (uint16_t framAddr, byte items, uint8_t values[]
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::readByte (uint16_t framAddr, uint8_t *value) 
 {
-	uint8_t buffer[1];
-	byte result = FRAM_MB85RC_I2C::readArray(framAddr, 1, buffer);
-	*value = buffer[0];
-	return result;
+	return FRAM_MB85RC_I2C::readArray(framAddr, 1, value);
 }
 /**************************************************************************/
 /*!
@@ -268,13 +392,67 @@ byte FRAM_MB85RC_I2C::readByte (uint16_t framAddr, uint8_t *value)
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::copyByte (uint16_t origAddr, uint16_t destAddr) 
 {
-	uint8_t buffer[1];
-	byte result = FRAM_MB85RC_I2C::readByte(origAddr, buffer);
-	result = FRAM_MB85RC_I2C::writeByte(destAddr, buffer[0]);
+	uint8_t data;
+	byte result = FRAM_MB85RC_I2C::readByte(origAddr, &data);
+	if (result == ERROR_0) result = FRAM_MB85RC_I2C::writeByte(destAddr, data);
 	return result;
 }
 
 
+/**************************************************************************/
+/*!
+    @brief  Copy a memory area from one chip to another, or within the same chip
+			Data is moved by chunks of FRAM_CHUNK_SIZE bytes, the largest burst
+			the Wire buffer allows. Overlapping areas on the same chip are
+			copied backwards so the source is never overwritten before being read.
+
+    @params[in] srcDev
+                The FRAM chip to read from
+    @params[in] srcAddr
+                The 16-bit address of the area to copy
+    @params[in] dstDev
+                The FRAM chip to write to - may be srcDev
+	@params[in] dstAddr
+				The 16-bit address of the destination area
+	@params[in] len
+				The number of bytes to copy
+    @returns    
+				0: success
+				8: length null
+				11: source or destination area out of range
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::copy (FRAM_MB85RC_I2C *srcDev, uint16_t srcAddr, FRAM_MB85RC_I2C *dstDev, uint16_t dstAddr, uint32_t len)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) srcAddr + len - 1) >= srcDev->maxaddress) return ERROR_11;
+	if (((uint32_t) dstAddr + len - 1) >= dstDev->maxaddress) return ERROR_11;
+	
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	byte result = ERROR_0;
+	byte chunk;
+	boolean backwards = (srcDev == dstDev) && (dstAddr > srcAddr) && (dstAddr < (uint32_t) srcAddr + len);
+	uint32_t offset = backwards ? len : 0;
+	uint32_t total = len;
+	
+	dstDev->_writeDepth++;
+	while ((len > 0) && (result == ERROR_0)) {
+		chunk = (len > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) len;
+		if (backwards) offset -= chunk;
+		result = srcDev->readArray(srcAddr + (uint16_t) offset, chunk, buffer);
+		if (result == ERROR_0) result = dstDev->writeArray(dstAddr + (uint16_t) offset, chunk, buffer);
+		if (!backwards) offset += chunk;
+		len -= chunk;
+	}
+	dstDev->_writeDepth--;
+	// a failed copy may have written any part of the destination
+	if (total != len) dstDev->notifyWrite(dstAddr, total);
+	return result;
+}
+
 /**************************************************************************/
 /*!
     @brief  Reads one bit from the specified FRAM address
@@ -297,9 +475,9 @@ byte FRAM_MB85RC_I2C::readBit(uint16_t framAddr, uint8_t bitNb, byte *bit)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, buffer);
-		*bit = bitRead(buffer[0], bitNb);
+		uint8_t data;
+		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, &data);
+		*bit = bitRead(data, bitNb);
 	}
 	return result;
 }
@@ -324,10 +502,12 @@ byte FRAM_MB85RC_I2C::setOneBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, buffer);
-		bitSet(buffer[0], bitNb);
-		result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, buffer);
+		uint8_t data;
+		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			bitSet(data, bitNb);
+			result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, &data);
+		}
 	}
 	return result;
 }
@@ -351,10 +531,12 @@ byte FRAM_MB85RC_I2C::clearOneBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, buffer);
-		bitClear(buffer[0], bitNb);
-		result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, buffer);
+		uint8_t data;
+		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			bitClear(data, bitNb);
+			result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, &data);
+		}
 	}
 	return result;
 }
@@ -378,17 +560,12 @@ byte FRAM_MB85RC_I2C::toggleBit(uint16_t framAddr, uint8_t bitNb)
 		result = ERROR_9;
 	}
 	else {
-		uint8_t buffer[1];
-		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, buffer);
-		
-		if ( (buffer[0] & (1 << bitNb)) == (1 << bitNb) )
-		{
-			bitClear(buffer[0], bitNb);
+		uint8_t data;
+		result = FRAM_MB85RC_I2C::readArray(framAddr, 1, &data);
+		if (result == ERROR_0) {
+			data ^= (1 << bitNb);
+			result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, &data);
 		}
-		else {
-			bitSet(buffer[0], bitNb);
-		}
-		result = FRAM_MB85RC_I2C::writeArray(framAddr, 1, buffer);
 	}
 	return result;
 }
@@ -406,10 +583,7 @@ byte FRAM_MB85RC_I2C::toggleBit(uint16_t framAddr, uint8_t bitNb)
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::readWord(uint16_t framAddr, uint16_t *value)
 {
-	uint8_t buffer[2];
-	byte result = FRAM_MB85RC_I2C::readArray(framAddr, 2, buffer);
-	*value = *reinterpret_cast<uint16_t *>(buffer);
-	return result;
+	return FRAM_MB85RC_I2C::readArray(framAddr, 2, reinterpret_cast<uint8_t *>(value));
 }
 
 /**************************************************************************/
@@ -443,10 +617,7 @@ byte FRAM_MB85RC_I2C::writeWord(uint16_t framAddr, uint16_t value)
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::readLong(uint16_t framAddr, uint32_t *value)
 {
-	uint8_t buffer[4];
-	byte result = FRAM_MB85RC_I2C::readArray(framAddr, 4, buffer);
-	*value = *reinterpret_cast<uint32_t *>(buffer);
-	return result;
+	return FRAM_MB85RC_I2C::readArray(framAddr, 4, reinterpret_cast<uint8_t *>(value));
 
 }
 /**************************************************************************/
@@ -527,6 +698,171 @@ boolean FRAM_MB85RC_I2C::isReady(void) {
 	return _framInitialised;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Return the size of the memory map in bytes
+
+    @params[in]  none
+	@returns
+				  number of addressable bytes, 0 if the chip is not identified
+*/
+/**************************************************************************/
+uint32_t FRAM_MB85RC_I2C::getMaxAddress(void) {
+	return maxaddress;
+}
+
+
+/**************************************************************************/
+/*!
+    @brief  Switches the instance to the SPI transport (MB85RS / FM25 series).
+			SPI chips are set by density as for the manual mode. SPI.begin()
+			is called, the chip select pin is driven by the library.
+			4K parts get the address bit A8 in the opcode, 16K to 512K
+			parts a 2 bytes address. 1M and 2M parts need a 3 bytes address
+			and are not supported.
+
+    @params[in]  csPin
+				  chip select pin, active low
+    @params[in]  chipDensity
+				  density of the chip in Kbits
+	@returns
+				  0: success
+				  7: density not supported, or above 512K
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::beginSPI(int csPin, uint16_t chipDensity) {
+	if (chipDensity > 512) return ERROR_7;
+	_manualMode = true;
+	density = chipDensity;
+	byte result = FRAM_MB85RC_I2C::checkDevice();
+	if (result == ERROR_0) {
+		_spiCsPin = csPin;
+		pinMode(_spiCsPin, OUTPUT);
+		digitalWrite(_spiCsPin, HIGH);
+		SPI.begin();
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Replaces the chip by a RAM image of the memory map (simulator).
+			All transfers are then served from the image, no bus access.
+
+    @params[in]  image
+				  buffer holding the memory map, its size must match the density
+    @params[in]  chipDensity
+				  density of the simulated chip, as for the manual mode constructor
+	@returns
+				  0: success
+				  7: density not supported
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::attachImage(uint8_t *image, uint16_t chipDensity) {
+	FRAM_MB85RC_I2C::detachImage();
+	_manualMode = true;
+	density = chipDensity;
+	byte result = FRAM_MB85RC_I2C::checkDevice();
+	if (result == ERROR_0) _image = image;
+	return result;
+}
+
+#if defined(FRAM_SIMULATOR_MMAP)
+/**************************************************************************/
+/*!
+    @brief  Simulates the chip with a memory mapped file (POSIX hosts only).
+			The file persists the content across runs, is created or
+			extended if needed and may be a raw dump of a real chip.
+			Several instances may map consecutive slices of one file to
+			simulate a multi-chip volume.
+
+    @params[in]  path
+				  image file path
+    @params[in]  chipDensity
+				  density of the simulated chip, as for the manual mode constructor
+    @params[in]  offset
+				  position of the memory map in the file
+	@returns
+				  0: success
+				  7: density not supported
+				  13: image file cannot be opened, sized or mapped
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::mapImageFile(const char *path, uint16_t chipDensity, uint32_t offset) {
+	FRAM_MB85RC_I2C::detachImage();
+	_manualMode = true;
+	density = chipDensity;
+	byte result = FRAM_MB85RC_I2C::checkDevice();
+	if (result != ERROR_0) return result;
+	
+	int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) return ERROR_13;
+	
+	struct stat st;
+	off_t end = (off_t) offset + maxaddress;
+	if ((fstat(fd, &st) != 0) || ((st.st_size < end) && (ftruncate(fd, end) != 0))) {
+		::close(fd);
+		return ERROR_13;
+	}
+	
+	// mmap offsets must be page aligned
+	uint32_t pad = offset % (uint32_t) sysconf(_SC_PAGESIZE);
+	void *base = mmap(NULL, maxaddress + pad, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) (offset - pad));
+	::close(fd);
+	if (base == MAP_FAILED) return ERROR_13;
+	
+	_mapBase = base;
+	_mapLength = maxaddress + pad;
+	_image = (uint8_t *) base + pad;
+	return ERROR_0;
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  Stops the simulation, a mapped image file is synced and unmapped.
+			The instance stays in manual mode with the simulated density.
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::detachImage(void) {
+	#if defined(FRAM_SIMULATOR_MMAP)
+		if (_mapBase != NULL) {
+			msync(_mapBase, _mapLength, MS_SYNC);
+			munmap(_mapBase, _mapLength);
+		}
+	#endif
+	_mapBase = NULL;
+	_mapLength = 0;
+	_image = NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tells if the transfers are served by a simulated image
+*/
+/**************************************************************************/
+boolean FRAM_MB85RC_I2C::isSimulated(void) {
+	return (_image != NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Attaches watches notified of the writes to this chip, NULL to
+			detach. writeBlock(), fill() and copy() notify once per call.
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::setWatch(FRAM_Watch *watch) {
+	_watch = watch;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Watches attached to this chip, NULL if none
+*/
+/**************************************************************************/
+FRAM_Watch *FRAM_MB85RC_I2C::getWatch(void) {
+	return _watch;
+}
 
 /**************************************************************************/
 /*!
@@ -596,6 +932,47 @@ byte FRAM_MB85RC_I2C::disableWP() {
 	return result;
 }
 /**************************************************************************/
+/*!
+    @brief  Fill a memory area with a single value, by bursts of FRAM_CHUNK_SIZE bytes
+
+    @params[in] framAddr
+                The 16-bit address of the first byte to fill
+    @params[in] len
+                The number of bytes to fill
+    @params[in] value
+                The value to write
+	@returns
+				  0: success
+				  8: length null
+				  11: memory area out of range
+				  other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::fill(uint16_t framAddr, uint32_t len, uint8_t value) {
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len - 1) >= maxaddress) return ERROR_11;
+	
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	byte result = ERROR_0;
+	byte chunk;
+	uint16_t start = framAddr;
+	uint32_t written = 0;
+	memset(buffer, value, FRAM_CHUNK_SIZE);
+	_writeDepth++;
+	while ((len > 0) && (result == ERROR_0)) {
+		chunk = (len > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) len;
+		result = FRAM_MB85RC_I2C::writeArray(framAddr, chunk, buffer);
+		if (result == ERROR_0) written += chunk;
+		framAddr += chunk;
+		len -= chunk;
+	}
+	_writeDepth--;
+	FRAM_MB85RC_I2C::notifyWrite(start, written);
+	return result;
+}
+/**************************************************************************/
 /*!
     @brief  Erase device by overwriting it to 0x00
 
@@ -608,7 +985,6 @@ byte FRAM_MB85RC_I2C::disableWP() {
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::eraseDevice(void) {
 		byte result = 0;
-		uint16_t i = 0;
 		
 		#ifdef SERIAL_DEBUG
 			if (Serial){
@@ -616,17 +992,14 @@ byte FRAM_MB85RC_I2C::eraseDevice(void) {
 			}
 		#endif
 		
-		while((i < maxaddress) && (result == 0)){
-		  result = FRAM_MB85RC_I2C::writeByte(i, 0x00);
-		  i++;
-		}
+		result = FRAM_MB85RC_I2C::fill(0, maxaddress, 0x00);
 		
 	
 		#if defined(SERIAL_DEBUG) && (SERIAL_DEBUG == 1)
 			if (Serial){
 				if (result !=0) {
-						Serial.print("ERROR: device erasing stopped at position ");
-						Serial.println(i, DEC);
+						Serial.print("ERROR: device erasing stopped, error code ");
+						Serial.println(result, DEC);
 						Serial.println("...... ...... ......");
 				}
 				else {
@@ -921,6 +1294,100 @@ void FRAM_MB85RC_I2C::I2CAddressAdapt(uint16_t framAddr) {
 }
 
 
+/**************************************************************************/
+/*!
+    @brief 	Largest single transfer of the transport: the Wire buffer limits
+			I2C bursts, SPI and simulated chips are only limited by the byte count
+
+	@returns	 number of bytes
+*/
+/**************************************************************************/
+byte FRAM_MB85RC_I2C::maxBurst(void) {
+	return ((_spiCsPin >= 0) || (_image != NULL)) ? 255 : FRAM_CHUNK_SIZE;
+}
+
+/**************************************************************************/
+/*!
+    @brief 	Reports a write to the attached watches, once for the outermost
+			write operation
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::notifyWrite(uint16_t framAddr, uint32_t len) {
+	if ((_watch != NULL) && (_writeDepth == 0)) _watch->notify(framAddr, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief 	SPI read sequence: READ (or FSTRD + dummy byte), address, data
+
+    @params[in]  framAddr : memory address
+    @params[in]  items : number of bytes
+	@param[out]	 values[] : bytes read
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::SPIRead(uint16_t framAddr, byte items, uint8_t values[]) {
+	SPI.beginTransaction(SPISettings(FRAM_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+	digitalWrite(_spiCsPin, LOW);
+	#if defined(FRAM_SPI_FAST_READ) && (FRAM_SPI_FAST_READ == 1)
+		FRAM_MB85RC_I2C::SPIAddress(SPI_OPCODE_FSTRD, framAddr);
+		SPI.transfer(0x00);
+	#else
+		FRAM_MB85RC_I2C::SPIAddress(SPI_OPCODE_READ, framAddr);
+	#endif
+	for (byte i=0; i < items; i++) {
+		values[i] = SPI.transfer(0x00);
+	}
+	digitalWrite(_spiCsPin, HIGH);
+	SPI.endTransaction();
+}
+
+/**************************************************************************/
+/*!
+    @brief 	SPI write sequence: WREN, then WRITE, address, data.
+			The write enable latch is reset by the chip at the end of WRITE.
+
+    @params[in]  framAddr : memory address
+    @params[in]  items : number of bytes
+	@params[in]	 values[] : bytes to write
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::SPIWrite(uint16_t framAddr, byte items, uint8_t values[]) {
+	SPI.beginTransaction(SPISettings(FRAM_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+	digitalWrite(_spiCsPin, LOW);
+	SPI.transfer(SPI_OPCODE_WREN);
+	digitalWrite(_spiCsPin, HIGH);
+	
+	digitalWrite(_spiCsPin, LOW);
+	FRAM_MB85RC_I2C::SPIAddress(SPI_OPCODE_WRITE, framAddr);
+	for (byte i=0; i < items; i++) {
+		SPI.transfer(values[i]);
+	}
+	digitalWrite(_spiCsPin, HIGH);
+	SPI.endTransaction();
+}
+
+/**************************************************************************/
+/*!
+    @brief 	Sends an opcode and a memory address: 1 byte with A8 in the
+			opcode on 4K parts, 2 bytes otherwise
+
+    @params[in]  opcode : READ, FSTRD or WRITE
+    @params[in]  framAddr : memory address
+*/
+/**************************************************************************/
+void FRAM_MB85RC_I2C::SPIAddress(uint8_t opcode, uint16_t framAddr) {
+	if (maxaddress == MAXADDRESS_04) {
+		// 4K parts: 1 address byte, A8 is bit 3 of the opcode
+		SPI.transfer(opcode | ((framAddr >> 5) & 0x08));
+	}
+	else {
+		SPI.transfer(opcode);
+		SPI.transfer(framAddr >> 8);
+	}
+	SPI.transfer(framAddr & 0xFF);
+}
+
+
 /**************************************************************************/
 /*!
     @brief  Read a 32bits value from the specified FRAM address
@@ -935,10 +1402,7 @@ void FRAM_MB85RC_I2C::I2CAddressAdapt(uint16_t framAddr) {
 /**************************************************************************/
 byte FRAM_MB85RC_I2C::readFloat(uint16_t framAddr, float *value)
 {
-	uint8_t buffer[4];
-	byte result = FRAM_MB85RC_I2C::readArray(framAddr, 4, buffer);
-	*value = *reinterpret_cast<float *>(buffer);
-	return result;
+	return FRAM_MB85RC_I2C::readArray(framAddr, 4, reinterpret_cast<uint8_t *>(value));
 
 }
 /**************************************************************************/
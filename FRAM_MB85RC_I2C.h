@@ -56,6 +56,7 @@
 #endif
 
 #include <Wire.h>
+#include <SPI.h>
 
 // Enabling debug I2C - comment to disable / normal operations
 #ifndef SERIAL_DEBUG
@@ -93,6 +94,16 @@
 #define MAXADDRESS_512 65536
 #define MAXADDRESS_1024 65536 // 1M devices are in fact managed as 2 512 devices from lib point of view > create 2 instances of the object with each a differnt address
 
+// Bulk transfers are split into chunks fitting the Wire library buffer (32 bytes on AVR)
+// 2 bytes of the buffer are used by the memory address when writing
+#ifndef FRAM_CHUNK_SIZE
+ #if defined(BUFFER_LENGTH) && (BUFFER_LENGTH <= 256)
+  #define FRAM_CHUNK_SIZE (BUFFER_LENGTH - 2)
+ #else
+  #define FRAM_CHUNK_SIZE 30
+ #endif
+#endif
+
 // Adresses
 #define MB85RC_ADDRESS_A000   0x50
 #define MB85RC_ADDRESS_A001   0x51
@@ -109,6 +120,21 @@
 #define SLEEP_MODE	0x86 //Cypress codes, not used here	
 #define HIGH_SPEED	0x08 //Cypress codes, not used here
 
+// SPI transport (MB85RS / FM25 series)
+#define SPI_OPCODE_WREN	0x06 // set write enable latch
+#define SPI_OPCODE_READ	0x03 // read memory
+#define SPI_OPCODE_WRITE	0x02 // write memory
+#define SPI_OPCODE_FSTRD	0x0B // fast read, one dummy byte after the address
+#ifndef FRAM_SPI_CLOCK
+#define FRAM_SPI_CLOCK 20000000 // Hz, lowered by the SPI library to the fastest clock the board supports
+#endif
+#ifndef FRAM_SPI_FAST_READ
+#define FRAM_SPI_FAST_READ 0 // 1 to read with FSTRD, for chips supporting it
+#endif
+
+// Simulator
+//#define FRAM_SIMULATOR_MMAP // uncomment on POSIX hosts to back a simulated chip with a memory mapped file
+
 // Managing Write protect pin
 #define MANAGE_WP false //false if WP pin remains not connected
 #define DEFAULT_WP_PIN	13 //write protection pin - active high, write enabled when low
@@ -127,7 +153,14 @@
 #define ERROR_9 9 // Bit position out of range
 #define ERROR_10 10 // Not permitted opération
 #define ERROR_11 11 // Memory address out of range
+#define ERROR_12 12 // Corrupted data - bad header or CRC mismatch
+#define ERROR_13 13 // Simulator image file unavailable
+#define ERROR_14 14 // Transfer buffer pool exhausted
+#define ERROR_15 15 // Key or record not found
+#define ERROR_16 16 // Storage area full
+#define ERROR_17 17 // Concurrent update, retry later
 
+class FRAM_Watch;
 
 class FRAM_MB85RC_I2C {
  public:
@@ -144,9 +177,12 @@ class FRAM_MB85RC_I2C {
 	byte	toggleBit(uint16_t framAddr, uint8_t bitNb);
 	byte	readArray (uint16_t framAddr, byte items, uint8_t value[]);
 	byte	writeArray (uint16_t framAddr, byte items, uint8_t value[]);
+	byte	readBlock (uint16_t framAddr, uint16_t items, uint8_t value[]);
+	byte	writeBlock (uint16_t framAddr, uint16_t items, uint8_t value[]);
 	byte	readByte (uint16_t framAddr, uint8_t *value);
 	byte	writeByte (uint16_t framAddr, uint8_t value);
 	byte	copyByte (uint16_t origAddr, uint16_t destAddr);
+	static byte	copy (FRAM_MB85RC_I2C *srcDev, uint16_t srcAddr, FRAM_MB85RC_I2C *dstDev, uint16_t dstAddr, uint32_t len);
 	byte	readWord(uint16_t framAddr, uint16_t *value);
 	byte	writeWord(uint16_t framAddr, uint16_t value);
 	byte	readLong(uint16_t framAddr, uint32_t *value);
@@ -155,10 +191,21 @@ class FRAM_MB85RC_I2C {
 	byte	writeLong(uint16_t framAddr, uint32_t value);
 	byte	getOneDeviceID(uint8_t idType, uint16_t *id);
 	boolean	isReady(void);
+	uint32_t	getMaxAddress(void);
 	boolean	getWPStatus(void);
 	byte	enableWP(void);
 	byte	disableWP(void);
+	byte	fill(uint16_t framAddr, uint32_t len, uint8_t value);
 	byte	eraseDevice(void);
+	byte	beginSPI(int csPin, uint16_t chipDensity);
+	byte	attachImage(uint8_t *image, uint16_t chipDensity);
+#if defined(FRAM_SIMULATOR_MMAP)
+	byte	mapImageFile(const char *path, uint16_t chipDensity, uint32_t offset);
+#endif
+	void	detachImage(void);
+	boolean	isSimulated(void);
+	void	setWatch(FRAM_Watch *watch);
+	FRAM_Watch	*getWatch(void);
   
  private:
 	uint8_t	i2c_addr;
@@ -169,16 +216,28 @@ class FRAM_MB85RC_I2C {
 	uint16_t	productid; 
 	uint16_t	densitycode;
 	uint16_t	density;
-	uint16_t	maxaddress;
+	uint32_t	maxaddress;
 
 	int	wpPin;
 	boolean	wpStatus;
 
+	int	_spiCsPin;
+	uint8_t	*_image;
+	void	*_mapBase;
+	uint32_t	_mapLength;
+	FRAM_Watch	*_watch;
+	uint8_t	_writeDepth;
+
 	byte	getDeviceIDs(void);	
 	byte	setDeviceIDs(void);
 	byte	initWP(boolean wp);
 	byte	deviceIDs2Serial(void);
 	void	I2CAddressAdapt(uint16_t framAddr);
+	byte	maxBurst(void);
+	void	SPIRead(uint16_t framAddr, byte items, uint8_t values[]);
+	void	SPIWrite(uint16_t framAddr, byte items, uint8_t values[]);
+	void	SPIAddress(uint8_t opcode, uint16_t framAddr);
+	void	notifyWrite(uint16_t framAddr, uint32_t len);
 };
 
 #endif
@@ -0,0 +1,237 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Mirror.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    RAM mirror of a memory area with write-back of the modified blocks.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Mirror.h"
+#include "FRAM_Watch.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	ram must point to a buffer of len bytes owned by the caller
+*/
+/**************************************************************************/
+FRAM_Mirror::FRAM_Mirror(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t len, uint8_t *ram)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_len = len;
+		_ram = ram;
+		_blockSize = ((uint32_t) len + FRAM_MIRROR_BLOCKS - 1) / FRAM_MIRROR_BLOCKS;
+		if (_blockSize == 0) _blockSize = 1;
+		memset(_dirty, 0, sizeof(_dirty));
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Loads the whole area from the chip by maximal bursts.
+			Pending modifications are discarded.
+
+    @returns
+				return code of the burst read
+*/
+/**************************************************************************/
+byte FRAM_Mirror::load(void)
+{
+	memset(_dirty, 0, sizeof(_dirty));
+	return _fram->readBlock(_framAddr, _len, _ram);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gives direct access to the mirrored data, without copy
+
+    @params[in] framAddr
+                The 16-bit chip address to access
+    @returns
+				pointer to the RAM copy of the address, NULL if out of the area
+*/
+/**************************************************************************/
+const uint8_t *FRAM_Mirror::data(uint16_t framAddr)
+{
+	if (!FRAM_Mirror::inRange(framAddr, 1)) return NULL;
+	return _ram + (framAddr - _framAddr);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads bytes from the mirror, no bus transfer
+
+    @params[in] framAddr
+                The 16-bit chip address to read from
+    @params[in] items
+                The number of bytes to read
+	@params[out] values[]
+                The array filled in with the mirrored data
+    @returns
+				0: success
+				8: number of bytes null
+				11: out of the mirrored area
+*/
+/**************************************************************************/
+byte FRAM_Mirror::read(uint16_t framAddr, uint16_t items, uint8_t values[])
+{
+	if (items == 0) return ERROR_8;
+	if (!FRAM_Mirror::inRange(framAddr, items)) return ERROR_11;
+	memcpy(values, _ram + (framAddr - _framAddr), items);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes bytes to the mirror and marks the blocks dirty. The chip is
+			only updated by flush().
+
+    @params[in] framAddr
+                The 16-bit chip address to write to
+    @params[in] items
+                The number of bytes to write
+	@params[in] values[]
+                The bytes to write
+    @returns
+				0: success
+				8: number of bytes null
+				11: out of the mirrored area
+*/
+/**************************************************************************/
+byte FRAM_Mirror::write(uint16_t framAddr, uint16_t items, const uint8_t values[])
+{
+	if (items == 0) return ERROR_8;
+	if (!FRAM_Mirror::inRange(framAddr, items)) return ERROR_11;
+
+	uint16_t offset = framAddr - _framAddr;
+	memcpy(_ram + offset, values, items);
+	for (uint16_t block = offset / _blockSize; block <= (offset + items - 1) / _blockSize; block++) {
+		bitSet(_dirty[block >> 3], block & 0x07);
+	}
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the dirty blocks to the chip. Contiguous dirty blocks are
+			written as a single run of consecutive bursts. Attached watches
+			are notified once, at the end of the flush.
+
+    @returns
+				0: success
+				other: return code of Wire.endTransmission(), remaining blocks stay dirty
+*/
+/**************************************************************************/
+byte FRAM_Mirror::flush(void)
+{
+	boolean pending = true;
+	byte result = ERROR_0;
+	FRAM_Watch *watch = _fram->getWatch();
+	if (watch != NULL) watch->beginBatch();
+	while (pending && (result == ERROR_0)) result = FRAM_Mirror::flushStep(0, &pending);
+	if (watch != NULL) watch->endBatch();
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the first run of contiguous dirty blocks, bounded in size
+				for callers with a time budget (power fail flush)
+
+    @params[in] maxBlocks
+                Maximum number of blocks written, 0 for the whole run
+    @params[out] *pending
+                true if dirty blocks remain
+    @returns
+					0: success
+					other: return code of Wire.endTransmission(), the blocks stay dirty
+*/
+/**************************************************************************/
+byte FRAM_Mirror::flushStep(uint16_t maxBlocks, boolean *pending)
+{
+	uint16_t blocks = ((uint32_t) _len + _blockSize - 1) / _blockSize;
+	uint16_t first, last, start, block;
+	uint32_t end;
+
+	for (first = 0; (first < blocks) && !FRAM_Mirror::isBlockDirty(first); first++);
+	if (first == blocks) {
+		*pending = false;
+		return ERROR_0;
+	}
+	for (last = first; ((last + 1) < blocks) && FRAM_Mirror::isBlockDirty(last + 1); last++) {
+		if ((maxBlocks != 0) && ((last + 1 - first) >= maxBlocks)) break;
+	}
+
+	start = first * _blockSize;
+	// the end of the last block may be 65536, past a mirror of 65535 bytes
+	end = (uint32_t) (last + 1) * _blockSize;
+	if (end > _len) end = _len;
+	*pending = true;
+	byte result = _fram->writeBlock(_framAddr + start, (uint16_t) (end - start), _ram + start);
+	if (result != ERROR_0) return result;
+
+	for (block = first; block <= last; block++) bitClear(_dirty[block >> 3], block & 0x07);
+	*pending = FRAM_Mirror::isDirty();
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tells if modifications are waiting for flush()
+*/
+/**************************************************************************/
+boolean FRAM_Mirror::isDirty(void)
+{
+	for (uint8_t i = 0; i < sizeof(_dirty); i++) {
+		if (_dirty[i] != 0) return true;
+	}
+	return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Size in bytes of the dirty tracking blocks
+*/
+/**************************************************************************/
+uint16_t FRAM_Mirror::getBlockSize(void)
+{
+	return _blockSize;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Tells if a chip address range lies within the mirrored area
+*/
+/**************************************************************************/
+boolean FRAM_Mirror::inRange(uint16_t framAddr, uint16_t items)
+{
+	return (framAddr >= _framAddr) && (((uint32_t) framAddr + items) <= ((uint32_t) _framAddr + _len));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tells if a dirty tracking block has been modified since the last flush
+*/
+/**************************************************************************/
+boolean FRAM_Mirror::isBlockDirty(uint16_t block)
+{
+	return bitRead(_dirty[block >> 3], block & 0x07);
+}
@@ -0,0 +1,81 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Mirror.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    RAM mirror of a memory area with write-back of the modified blocks.
+	Reads are served from RAM without any bus transfer, writes only update RAM
+	and mark blocks dirty. flush() writes the dirty blocks, coalescing
+	contiguous ones into consecutive bursts.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_MIRROR_H_
+#define _FRAM_MIRROR_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Number of dirty tracking blocks - the block size is the area length divided by this number
+#ifndef FRAM_MIRROR_BLOCKS
+#define FRAM_MIRROR_BLOCKS 64
+#endif
+
+
+class FRAM_Mirror {
+ public:
+	FRAM_Mirror(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t len, uint8_t *ram);
+
+	byte	load(void);
+	const uint8_t	*data(uint16_t framAddr);
+	byte	read(uint16_t framAddr, uint16_t items, uint8_t values[]);
+	byte	write(uint16_t framAddr, uint16_t items, const uint8_t values[]);
+	byte	flush(void);
+	byte	flushStep(uint16_t maxBlocks, boolean *pending);
+	boolean	isDirty(void);
+	uint16_t	getBlockSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint16_t	_len;
+	uint8_t	*_ram;
+	uint16_t	_blockSize;
+	uint8_t	_dirty[(FRAM_MIRROR_BLOCKS + 7) / 8];
+
+	boolean	inRange(uint16_t framAddr, uint16_t items);
+	boolean	isBlockDirty(uint16_t block);
+};
+
+#endif
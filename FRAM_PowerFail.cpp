@@ -0,0 +1,289 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_PowerFail.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Brownout-triggered emergency flush with prioritized sources.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_PowerFail.h"
+
+#define FRAM_POWERFAIL_REPORT_HEADER 3
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	The report takes 3 + number of sources bytes at reportAddr
+*/
+/**************************************************************************/
+FRAM_PowerFail::FRAM_PowerFail(FRAM_MB85RC_I2C *fram, uint16_t reportAddr)
+{
+		_fram = fram;
+		_reportAddr = reportAddr;
+		_budget = 0xFFFFFFFFUL;
+		_count = 0;
+		_elapsed = 0;
+		_longestStep = FRAM_POWERFAIL_STEP_US;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Registers a RAM mirror, flushed by FRAM_POWERFAIL_MIRROR_BLOCKS
+				blocks per step
+
+    @params[in] mirror
+                The mirror to flush
+    @params[in] priority
+                0 is flushed first, sources of equal priority keep the order of registration
+    @returns
+					0: success
+					16: FRAM_POWERFAIL_SOURCES reached
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::addMirror(FRAM_Mirror *mirror, uint8_t priority)
+{
+	return FRAM_PowerFail::insert(mirror, NULL, NULL, priority);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Registers an application source flushed by a bounded step function
+
+    @params[in] step
+                Writes a bounded amount of data, see FRAM_FlushStep
+    @params[in] context
+                Passed to the step function
+    @params[in] priority
+                0 is flushed first, sources of equal priority keep the order of registration
+    @returns
+					0: success
+					16: FRAM_POWERFAIL_SOURCES reached
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::addSource(FRAM_FlushStep step, void *context, uint8_t priority)
+{
+	return FRAM_PowerFail::insert(NULL, step, context, priority);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the time available for the flush, from the call of
+				onPowerFail(), typically the hold-up time of the supply minus
+				the brownout detection delay. Unlimited by default.
+*/
+/**************************************************************************/
+void FRAM_PowerFail::setBudget(uint32_t budgetMicros)
+{
+	_budget = budgetMicros;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the duration of the longest step, counted against the
+				budget before a step is started. The flush usually runs once
+				per boot, at the real brownout: without an estimate the first
+				step would not be bounded. Measure it on the target with a
+				test flush (getLongestStep()) and keep a margin. Steps longer
+				than the estimate raise it. FRAM_POWERFAIL_STEP_US by default.
+*/
+/**************************************************************************/
+void FRAM_PowerFail::setStepEstimate(uint32_t stepMicros)
+{
+	_longestStep = stepMicros;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks all sources pending in the report. Called at boot once the
+				report of the previous power loss has been read, and after
+				changes to the sources.
+
+    @returns
+					0: success
+					11: report out of the memory map
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::arm(void)
+{
+	uint8_t report[FRAM_POWERFAIL_REPORT_HEADER + FRAM_POWERFAIL_SOURCES];
+	report[0] = 'P';
+	report[1] = 'F';
+	report[2] = _count;
+	for (uint8_t i = 0; i < _count; i++) {
+		report[FRAM_POWERFAIL_REPORT_HEADER + i] = FRAM_POWERFAIL_PENDING;
+		_status[i] = FRAM_POWERFAIL_PENDING;
+	}
+	return _fram->writeArray(_reportAddr, FRAM_POWERFAIL_REPORT_HEADER + _count, report);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Flushes the sources in priority order by bounded steps. A step is
+				only started if the longest step, estimated or seen, plus the
+				status write still fit in the budget. The status byte of a source is written
+				as soon as it is completed, stopped or failed.
+
+				May be called from the brownout interrupt: interrupts are enabled
+				again since the Wire library needs them. The interrupted code must
+				not be using the bus, and the caller should disable the brownout
+				interrupt source first.
+
+    @returns
+					0: flush finished, see getStatus() or the report
+					other: first return code of Wire.endTransmission() received
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::onPowerFail(void)
+{
+	uint32_t start = micros();
+	uint32_t stepStart, duration;
+	boolean pending, timeout;
+	uint16_t steps;
+	byte result = ERROR_0;
+	byte step;
+
+	interrupts();
+	for (uint8_t i = 0; i < _count; i++) _status[i] = FRAM_POWERFAIL_PENDING;
+
+	timeout = false;
+	for (uint8_t i = 0; (i < _count) && !timeout; i++) {
+		pending = true;
+		steps = 0;
+		step = ERROR_0;
+		while (pending) {
+			if (((micros() - start) + _longestStep + FRAM_POWERFAIL_GUARD_US) > _budget) {
+				timeout = true;
+				break;
+			}
+			stepStart = micros();
+			if (_mirror[i] != NULL) step = _mirror[i]->flushStep(FRAM_POWERFAIL_MIRROR_BLOCKS, &pending);
+			else step = _step[i](_context[i], &pending);
+			duration = micros() - stepStart;
+			if (duration > _longestStep) _longestStep = duration;
+			if (step != ERROR_0) break;
+			steps++;
+		}
+
+		if (step != ERROR_0) {
+			_status[i] = FRAM_POWERFAIL_FAILED;
+			if (result == ERROR_0) result = step;
+		}
+		else if (!pending) {
+			_status[i] = FRAM_POWERFAIL_COMPLETE;
+		}
+		else if (steps != 0) {
+			_status[i] = FRAM_POWERFAIL_PARTIAL;
+		}
+		if (_status[i] != FRAM_POWERFAIL_PENDING) {
+			_fram->writeByte(_reportAddr + FRAM_POWERFAIL_REPORT_HEADER + i, _status[i]);
+		}
+	}
+	_elapsed = micros() - start;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the status of a source recorded by the last flush
+
+    @params[in] source
+                Rank of the source in priority order
+    @params[out] *status
+                FRAM_POWERFAIL_PENDING, _COMPLETE, _PARTIAL or _FAILED
+    @returns
+					0: success
+					11: no such source in the report
+					12: no report at this address
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::readReport(uint8_t source, uint8_t *status)
+{
+	uint8_t header[FRAM_POWERFAIL_REPORT_HEADER];
+	byte result = _fram->readArray(_reportAddr, FRAM_POWERFAIL_REPORT_HEADER, header);
+	if (result != ERROR_0) return result;
+	if ((header[0] != 'P') || (header[1] != 'F')) return ERROR_12;
+	if (source >= header[2]) return ERROR_11;
+	return _fram->readByte(_reportAddr + FRAM_POWERFAIL_REPORT_HEADER + source, status);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Status of a source after onPowerFail(), in RAM
+*/
+/**************************************************************************/
+uint8_t FRAM_PowerFail::getStatus(uint8_t source)
+{
+	return (source < _count) ? _status[source] : FRAM_POWERFAIL_PENDING;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Duration of the last onPowerFail() in microseconds
+*/
+/**************************************************************************/
+uint32_t FRAM_PowerFail::getElapsed(void)
+{
+	return _elapsed;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Longest flush step, in microseconds: the estimate, or the
+				longest step measured when above it. Useful to size the budget
+				and FRAM_POWERFAIL_MIRROR_BLOCKS.
+*/
+/**************************************************************************/
+uint32_t FRAM_PowerFail::getLongestStep(void)
+{
+	return _longestStep;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Inserts a source in priority order
+
+    @returns
+					0: success
+					16: FRAM_POWERFAIL_SOURCES reached
+*/
+/**************************************************************************/
+byte FRAM_PowerFail::insert(FRAM_Mirror *mirror, FRAM_FlushStep step, void *context, uint8_t priority)
+{
+	if (_count == FRAM_POWERFAIL_SOURCES) return ERROR_16;
+
+	uint8_t i = _count;
+	while ((i > 0) && (_priority[i - 1] > priority)) {
+		_mirror[i] = _mirror[i - 1];
+		_step[i] = _step[i - 1];
+		_context[i] = _context[i - 1];
+		_priority[i] = _priority[i - 1];
+		i--;
+	}
+	_mirror[i] = mirror;
+	_step[i] = step;
+	_context[i] = context;
+	_priority[i] = priority;
+	_status[_count] = FRAM_POWERFAIL_PENDING;
+	_count++;
+	return ERROR_0;
+}
@@ -0,0 +1,119 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_PowerFail.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Emergency flush for brownout or power-good interrupts. Registered sources -
+	RAM mirrors and application queues - are flushed by bounded steps in
+	priority order within a time budget, and a status byte per source records
+	on the chip what has been persisted.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_POWERFAIL_H_
+#define _FRAM_POWERFAIL_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_Mirror.h"
+
+#ifndef FRAM_POWERFAIL_SOURCES
+#define FRAM_POWERFAIL_SOURCES 8
+#endif
+
+// Dirty blocks written per step for a mirror source
+#ifndef FRAM_POWERFAIL_MIRROR_BLOCKS
+#define FRAM_POWERFAIL_MIRROR_BLOCKS 2
+#endif
+
+// Step duration assumed before any step has been measured, in microseconds.
+// Conservative: two 64-byte mirror blocks take about 15 ms on a 100 kHz bus.
+#ifndef FRAM_POWERFAIL_STEP_US
+#define FRAM_POWERFAIL_STEP_US 15000
+#endif
+
+// Time kept for the status byte write at the end of a source, in microseconds
+#ifndef FRAM_POWERFAIL_GUARD_US
+#define FRAM_POWERFAIL_GUARD_US 100
+#endif
+
+// Source status recorded on the chip
+#define FRAM_POWERFAIL_PENDING 0	// not persisted, or flush not reached
+#define FRAM_POWERFAIL_COMPLETE 1	// fully persisted
+#define FRAM_POWERFAIL_PARTIAL 2	// budget exhausted during the source
+#define FRAM_POWERFAIL_FAILED 3	// bus error during the source
+
+/*
+	Bounded flush step of an application source (queue...), writes a bounded
+	amount of data and sets *pending when more remains. Returns an error code.
+*/
+typedef byte (*FRAM_FlushStep)(void *context, boolean *pending);
+
+/*
+	Report area: "PF", number of sources, then one status byte per source in
+	priority order
+*/
+
+class FRAM_PowerFail {
+ public:
+	FRAM_PowerFail(FRAM_MB85RC_I2C *fram, uint16_t reportAddr);
+
+	byte	addMirror(FRAM_Mirror *mirror, uint8_t priority);
+	byte	addSource(FRAM_FlushStep step, void *context, uint8_t priority);
+	void	setBudget(uint32_t budgetMicros);
+	void	setStepEstimate(uint32_t stepMicros);
+	byte	arm(void);
+	byte	onPowerFail(void);
+	byte	readReport(uint8_t source, uint8_t *status);
+	uint8_t	getStatus(uint8_t source);
+	uint32_t	getElapsed(void);
+	uint32_t	getLongestStep(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_reportAddr;
+	uint32_t	_budget;
+	uint8_t	_count;
+	FRAM_Mirror	*_mirror[FRAM_POWERFAIL_SOURCES];
+	FRAM_FlushStep	_step[FRAM_POWERFAIL_SOURCES];
+	void	*_context[FRAM_POWERFAIL_SOURCES];
+	uint8_t	_priority[FRAM_POWERFAIL_SOURCES];
+	volatile uint8_t	_status[FRAM_POWERFAIL_SOURCES];
+	volatile uint32_t	_elapsed;
+	uint32_t	_longestStep;
+
+	byte	insert(FRAM_Mirror *mirror, FRAM_FlushStep step, void *context, uint8_t priority);
+};
+
+#endif
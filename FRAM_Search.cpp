@@ -0,0 +1,142 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Search.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Pattern search (memmem) across a memory area by bursts.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Search.h"
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Finds the first occurrence of a pattern
+
+    @params[in] fram
+                The FRAM chip to search
+    @params[in] pattern
+                The bytes to find
+    @params[in] patternLen
+                The pattern length, 1 to FRAM_SEARCH_MAX_PATTERN
+    @params[in] start
+                The 16-bit address where the search starts
+    @params[in] end
+                The address following the searched area, getMaxAddress() for the whole chip
+    @params[out] *found
+                Address of the first match
+    @returns
+					0: success
+					8: pattern length null
+					11: area out of range or pattern longer than FRAM_SEARCH_MAX_PATTERN
+					14: transfer buffer pool exhausted
+					15: pattern not found
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Search::find(FRAM_MB85RC_I2C *fram, const uint8_t *pattern, uint8_t patternLen, uint16_t start, uint32_t end, uint16_t *found)
+{
+	uint16_t matches;
+	byte result = FRAM_Search::findAll(fram, pattern, patternLen, start, end, FRAM_Search::first, found, &matches);
+	if ((result == ERROR_0) && (matches == 0)) result = ERROR_15;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Finds all occurrences of a pattern, overlapping ones included
+
+    @params[in] fram
+                The FRAM chip to search
+    @params[in] pattern
+                The bytes to find
+    @params[in] patternLen
+                The pattern length, 1 to FRAM_SEARCH_MAX_PATTERN
+    @params[in] start
+                The 16-bit address where the search starts
+    @params[in] end
+                The address following the searched area, getMaxAddress() for the whole chip
+    @params[in] handler
+                Called for each match in ascending order, NULL to only count
+    @params[in] context
+                Passed to the handler
+    @params[out] *matches
+                Number of matches reported
+    @returns
+					0: success
+					8: pattern length null
+					11: area out of range or pattern longer than FRAM_SEARCH_MAX_PATTERN
+					14: transfer buffer pool exhausted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Search::findAll(FRAM_MB85RC_I2C *fram, const uint8_t *pattern, uint8_t patternLen, uint16_t start, uint32_t end, FRAM_MatchHandler handler, void *context, uint16_t *matches)
+{
+	*matches = 0;
+	if (patternLen == 0) return ERROR_8;
+	if ((patternLen > FRAM_SEARCH_MAX_PATTERN) || (end > fram->getMaxAddress()) || (start > end)) return ERROR_11;
+
+	FRAM_PoolBuffer windowPool;
+	if (windowPool.data == NULL) return ERROR_14;
+	uint8_t *window = windowPool.data;
+
+	uint32_t windowAddr = start;	// chip address of window[0]
+	uint32_t next = start;			// next address to read
+	uint16_t kept = 0;				// bytes carried from the previous read
+	uint16_t count, avail, last;
+	const uint8_t *candidate;
+	byte result = ERROR_0;
+
+	while (next < end) {
+		count = FRAM_POOL_BUFFER_SIZE - kept;
+		if (count > (end - next)) count = (uint16_t) (end - next);
+		result = fram->readBlock((uint16_t) next, count, window + kept);
+		if (result != ERROR_0) break;
+		next += count;
+		avail = kept + count;
+
+		if (avail >= patternLen) {
+			// last position where the whole pattern fits in the window
+			last = avail - patternLen;
+			candidate = window;
+			while ((candidate = (const uint8_t *) memchr(candidate, pattern[0], last - (candidate - window) + 1)) != NULL) {
+				if (memcmp(candidate, pattern, patternLen) == 0) {
+					(*matches)++;
+					if ((handler != NULL) && !handler((uint16_t) (windowAddr + (candidate - window)), context)) return ERROR_0;
+				}
+				if ((uint16_t) (candidate - window) == last) break;
+				candidate++;
+			}
+		}
+
+		// starts not checked yet are the last patternLen - 1 bytes
+		kept = (avail < (patternLen - 1)) ? avail : (patternLen - 1);
+		memmove(window, window + avail - kept, kept);
+		windowAddr += avail - kept;
+	}
+	return result;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Match handler of find(): keeps the address and stops
+*/
+/**************************************************************************/
+boolean FRAM_Search::first(uint16_t framAddr, void *context)
+{
+	*((uint16_t *) context) = framAddr;
+	return false;
+}
@@ -0,0 +1,66 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Search.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Pattern search over a memory area: the area is read by bursts into a
+	window carrying the last pattern length - 1 bytes of the previous read,
+	so that matches across burst boundaries are found. Candidates are located
+	with memchr and confirmed with memcmp.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_SEARCH_H_
+#define _FRAM_SEARCH_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_BufferPool.h"
+
+// Longest pattern, half the window: each read brings at least as many new bytes
+#define FRAM_SEARCH_MAX_PATTERN (FRAM_POOL_BUFFER_SIZE / 2)
+
+// Called for each match, return false to stop the search
+typedef boolean (*FRAM_MatchHandler)(uint16_t framAddr, void *context);
+
+class FRAM_Search {
+ public:
+	static byte	find(FRAM_MB85RC_I2C *fram, const uint8_t *pattern, uint8_t patternLen, uint16_t start, uint32_t end, uint16_t *found);
+	static byte	findAll(FRAM_MB85RC_I2C *fram, const uint8_t *pattern, uint8_t patternLen, uint16_t start, uint32_t end, FRAM_MatchHandler handler, void *context, uint16_t *matches);
+
+ private:
+	static boolean	first(uint16_t framAddr, void *context);
+};
+
+#endif
@@ -0,0 +1,308 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_SelfTest.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Memory self-test: March C- and address lines walking ones by bursts.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_SelfTest.h"
+#include "FRAM_BufferPool.h"
+
+#define FRAM_SELFTEST_NONE -1
+
+static const uint8_t backgrounds[4] = { 0x00, 0x55, 0x33, 0x0F };
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Tests the whole chip: address lines then March C-
+
+    @params[in] fram
+                The FRAM chip to test
+    @params[in] preserve
+                true to keep the chip content, see marchC()
+    @params[out] *report
+                Faults and throughput, handler and context set by the caller
+    @returns
+					0: no fault
+					12: faults found, see report
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::run(FRAM_MB85RC_I2C *fram, boolean preserve, FRAM_SelfTestReport *report)
+{
+	FRAM_SelfTest::start(report);
+	uint32_t begin = micros();
+	byte result = FRAM_SelfTest::addressRegion(fram, 0, fram->getMaxAddress(), report);
+	if (result == ERROR_0) result = FRAM_SelfTest::marchRegion(fram, 0, fram->getMaxAddress(), preserve, report);
+	report->elapsed = micros() - begin;
+	if ((result == ERROR_0) && (report->faults != 0)) result = ERROR_12;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Runs March C- over a memory area for each data background:
+				w0; up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0); r0
+				Each element reads then writes a whole chunk, descending
+				elements take the chunks in descending order. Inside a chunk
+				all cells are read before any is written, so the March order
+				only holds between chunks: a coupling fault between two cells
+				of the same FRAM_CHUNK_SIZE chunk, the write of one disturbing
+				the other, is not detected.
+				With preserve, the whole sequence runs chunk by chunk between
+				a save and a restore of the chunk: coupling faults between
+				chunks are not covered.
+
+    @params[in] fram
+                The FRAM chip to test
+    @params[in] framAddr
+                The 16-bit address of the area
+    @params[in] len
+                The number of bytes to test
+    @params[in] preserve
+                true to keep the content of the area
+    @params[out] *report
+                Faults and throughput, handler and context set by the caller
+    @returns
+					0: no fault
+					8: length null
+					11: area out of range
+					12: faults found, see report
+					14: transfer buffer pool exhausted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::marchC(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean preserve, FRAM_SelfTestReport *report)
+{
+	FRAM_SelfTest::start(report);
+	uint32_t begin = micros();
+	byte result = FRAM_SelfTest::marchRegion(fram, framAddr, len, preserve, report);
+	report->elapsed = micros() - begin;
+	if ((result == ERROR_0) && (report->faults != 0)) result = ERROR_12;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the address lines by walking ones: for each address bit,
+				the bytes at the base and at base + 2^bit get distinct values
+				and must not alias. Both bytes are saved and restored.
+
+    @params[in] fram
+                The FRAM chip to test
+    @params[in] framAddr
+                The 16-bit address of the area, the base
+    @params[in] len
+                The number of bytes covered
+    @params[out] *report
+                Faults and throughput, handler and context set by the caller
+    @returns
+					0: no fault
+					8: length null
+					11: area out of range
+					12: faults found, see report
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::addressTest(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, FRAM_SelfTestReport *report)
+{
+	FRAM_SelfTest::start(report);
+	uint32_t begin = micros();
+	byte result = FRAM_SelfTest::addressRegion(fram, framAddr, len, report);
+	report->elapsed = micros() - begin;
+	if ((result == ERROR_0) && (report->faults != 0)) result = ERROR_12;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Bus throughput of the last test in bytes per second
+*/
+/**************************************************************************/
+uint32_t FRAM_SelfTest::throughput(const FRAM_SelfTestReport *report)
+{
+	if (report->elapsed == 0) return 0;
+	return (uint32_t) ((float) report->bytes * 1000000.0 / report->elapsed);
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Runs one March element over an area, chunk by chunk
+
+    @params[in] descending
+                true to take the chunks from the end
+    @params[in] expected
+                Value to check by a read, FRAM_SELFTEST_NONE for no read
+    @params[in] value
+                Value to write, FRAM_SELFTEST_NONE for no write
+    @returns
+					return code of the burst transfers
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::element(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean descending, int16_t expected, int16_t value, uint8_t buffer[], FRAM_SelfTestReport *report)
+{
+	uint32_t chunks = (len + FRAM_CHUNK_SIZE - 1) / FRAM_CHUNK_SIZE;
+	uint32_t offset;
+	uint16_t addr;
+	byte chunk, i;
+	byte result = ERROR_0;
+
+	for (uint32_t n = 0; (n < chunks) && (result == ERROR_0); n++) {
+		offset = (descending ? (chunks - 1 - n) : n) * FRAM_CHUNK_SIZE;
+		addr = framAddr + (uint16_t) offset;
+		chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+
+		if (expected != FRAM_SELFTEST_NONE) {
+			result = fram->readArray(addr, chunk, buffer);
+			if (result != ERROR_0) break;
+			report->bytes += chunk;
+			for (i = 0; i < chunk; i++) {
+				if (buffer[i] != (uint8_t) expected) FRAM_SelfTest::fault(report, addr + i, (uint8_t) expected, buffer[i]);
+			}
+		}
+		if (value != FRAM_SELFTEST_NONE) {
+			memset(buffer, (uint8_t) value, chunk);
+			result = fram->writeArray(addr, chunk, buffer);
+			report->bytes += chunk;
+		}
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Runs the six elements of March C- for each data background
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::march(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint8_t buffer[], FRAM_SelfTestReport *report)
+{
+	byte result = ERROR_0;
+	int16_t b, c;
+
+	for (uint8_t k = 0; (k < FRAM_SELFTEST_BACKGROUNDS) && (k < sizeof(backgrounds)) && (result == ERROR_0); k++) {
+		b = backgrounds[k];
+		c = (uint8_t) ~backgrounds[k];
+		result = FRAM_SelfTest::element(fram, framAddr, len, false, FRAM_SELFTEST_NONE, b, buffer, report);
+		if (result == ERROR_0) result = FRAM_SelfTest::element(fram, framAddr, len, false, b, c, buffer, report);
+		if (result == ERROR_0) result = FRAM_SelfTest::element(fram, framAddr, len, false, c, b, buffer, report);
+		if (result == ERROR_0) result = FRAM_SelfTest::element(fram, framAddr, len, true, b, c, buffer, report);
+		if (result == ERROR_0) result = FRAM_SelfTest::element(fram, framAddr, len, true, c, b, buffer, report);
+		if (result == ERROR_0) result = FRAM_SelfTest::element(fram, framAddr, len, false, b, FRAM_SELFTEST_NONE, buffer, report);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  March C- over an area, whole or chunk by chunk with save / restore
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::marchRegion(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean preserve, FRAM_SelfTestReport *report)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len) > fram->getMaxAddress()) return ERROR_11;
+
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	if (!preserve) return FRAM_SelfTest::march(fram, framAddr, len, bufferPool.data, report);
+
+	FRAM_PoolBuffer savePool;
+	if (savePool.data == NULL) return ERROR_14;
+	uint32_t offset = 0;
+	byte chunk, restore;
+	byte result = ERROR_0;
+
+	while ((offset < len) && (result == ERROR_0)) {
+		chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		result = fram->readArray(framAddr + (uint16_t) offset, chunk, savePool.data);
+		if (result != ERROR_0) break;
+		result = FRAM_SelfTest::march(fram, framAddr + (uint16_t) offset, chunk, bufferPool.data, report);
+		restore = fram->writeArray(framAddr + (uint16_t) offset, chunk, savePool.data);
+		report->bytes += 2 * chunk;
+		if (result == ERROR_0) result = restore;
+		offset += chunk;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walking ones over the address bits covered by an area. The two
+				bytes of each pair are written back on every exit path, a bus
+				error included.
+*/
+/**************************************************************************/
+byte FRAM_SelfTest::addressRegion(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, FRAM_SelfTestReport *report)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len) > fram->getMaxAddress()) return ERROR_11;
+
+	uint8_t base, other, check;
+	uint16_t addr;
+	byte restore;
+	byte result = fram->readByte(framAddr, &base);
+	if (result != ERROR_0) return result;
+
+	for (uint32_t offset = 1; (offset < len) && (result == ERROR_0); offset <<= 1) {
+		addr = framAddr + (uint16_t) offset;
+		result = fram->readByte(addr, &other);
+		if (result != ERROR_0) break;
+		result = fram->writeByte(framAddr, 0xAA);
+		if (result == ERROR_0) result = fram->writeByte(addr, 0x55);
+		if (result == ERROR_0) result = fram->readByte(framAddr, &check);
+		if (result == ERROR_0) {
+			if (check != 0xAA) FRAM_SelfTest::fault(report, framAddr, 0xAA, check);
+			result = fram->readByte(addr, &check);
+		}
+		if (result == ERROR_0) {
+			if (check != 0x55) FRAM_SelfTest::fault(report, addr, 0x55, check);
+		}
+		restore = fram->writeByte(addr, other);
+		if (result == ERROR_0) result = restore;
+		report->bytes += 6;
+	}
+	restore = fram->writeByte(framAddr, base);
+	if (result == ERROR_0) result = restore;
+	report->bytes += 2;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records a faulty byte
+*/
+/**************************************************************************/
+void FRAM_SelfTest::fault(FRAM_SelfTestReport *report, uint16_t framAddr, uint8_t expected, uint8_t actual)
+{
+	if (report->faults == 0) report->firstFault = framAddr;
+	report->faults++;
+	if (report->handler != NULL) report->handler(framAddr, expected, actual, report->context);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clears the counters of a report, the handler is kept
+*/
+/**************************************************************************/
+void FRAM_SelfTest::start(FRAM_SelfTestReport *report)
+{
+	report->faults = 0;
+	report->firstFault = 0;
+	report->bytes = 0;
+	report->elapsed = 0;
+}
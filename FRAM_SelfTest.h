@@ -0,0 +1,84 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_SelfTest.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Memory self-test for incoming inspection: March C- over data backgrounds
+	and walking ones on the address lines, run by chunked bursts. Faulty
+	addresses and throughput are reported. The non-destructive mode saves and
+	restores each chunk around its test. The March order is kept between
+	chunks only, see FRAM_SelfTest::marchC().
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_SELFTEST_H_
+#define _FRAM_SELFTEST_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Number of data backgrounds of March C-, from 0x00, 0x55, 0x33, 0x0F
+#ifndef FRAM_SELFTEST_BACKGROUNDS
+#define FRAM_SELFTEST_BACKGROUNDS 2
+#endif
+
+// Called for each faulty byte found
+typedef void (*FRAM_FaultHandler)(uint16_t framAddr, uint8_t expected, uint8_t actual, void *context);
+
+struct FRAM_SelfTestReport {
+	FRAM_FaultHandler	handler;	// optional, set by the caller
+	void	*context;				// passed to the handler
+	uint32_t	faults;				// faulty bytes found, a byte may count several times
+	uint16_t	firstFault;			// address of the first fault
+	uint32_t	bytes;				// bytes transferred on the bus
+	uint32_t	elapsed;			// duration in microseconds
+};
+
+class FRAM_SelfTest {
+ public:
+	static byte	run(FRAM_MB85RC_I2C *fram, boolean preserve, FRAM_SelfTestReport *report);
+	static byte	marchC(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean preserve, FRAM_SelfTestReport *report);
+	static byte	addressTest(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, FRAM_SelfTestReport *report);
+	static uint32_t	throughput(const FRAM_SelfTestReport *report);
+
+ private:
+	static byte	element(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean descending, int16_t expected, int16_t value, uint8_t buffer[], FRAM_SelfTestReport *report);
+	static byte	march(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint8_t buffer[], FRAM_SelfTestReport *report);
+	static byte	marchRegion(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, boolean preserve, FRAM_SelfTestReport *report);
+	static byte	addressRegion(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, FRAM_SelfTestReport *report);
+	static void	fault(FRAM_SelfTestReport *report, uint16_t framAddr, uint8_t expected, uint8_t actual);
+	static void	start(FRAM_SelfTestReport *report);
+};
+
+#endif
@@ -0,0 +1,223 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sha256.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Streaming SHA-256.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Sha256.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t k[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+static const uint32_t initial[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL, 0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+};
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+*/
+/**************************************************************************/
+FRAM_Sha256::FRAM_Sha256(void)
+{
+		FRAM_Sha256::begin();
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Starts a new hash
+*/
+/**************************************************************************/
+void FRAM_Sha256::begin(void)
+{
+	memcpy(_h, initial, sizeof(_h));
+	_length = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Hashes the next bytes of the message
+*/
+/**************************************************************************/
+void FRAM_Sha256::update(const uint8_t *data, uint16_t len)
+{
+	uint8_t used = _length % FRAM_SHA256_BLOCK_SIZE;
+	uint8_t n;
+	_length += len;
+
+	if (used != 0) {
+		n = ((FRAM_SHA256_BLOCK_SIZE - used) < len) ? (FRAM_SHA256_BLOCK_SIZE - used) : len;
+		memcpy(_block + used, data, n);
+		data += n;
+		len -= n;
+		if ((used + n) < FRAM_SHA256_BLOCK_SIZE) return;
+		FRAM_Sha256::transform(_block);
+	}
+	while (len >= FRAM_SHA256_BLOCK_SIZE) {
+		FRAM_Sha256::transform(data);
+		data += FRAM_SHA256_BLOCK_SIZE;
+		len -= FRAM_SHA256_BLOCK_SIZE;
+	}
+	memcpy(_block, data, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Pads the message and returns its digest, big endian. begin()
+				must be called before hashing another message.
+*/
+/**************************************************************************/
+void FRAM_Sha256::finish(uint8_t digest[])
+{
+	uint8_t used = _length % FRAM_SHA256_BLOCK_SIZE;
+	uint32_t bits = _length << 3;
+
+	_block[used++] = 0x80;
+	if (used > (FRAM_SHA256_BLOCK_SIZE - 8)) {
+		memset(_block + used, 0, FRAM_SHA256_BLOCK_SIZE - used);
+		FRAM_Sha256::transform(_block);
+		used = 0;
+	}
+	memset(_block + used, 0, FRAM_SHA256_BLOCK_SIZE - 8 - used);
+	FRAM_Sha256::store32(_block + FRAM_SHA256_BLOCK_SIZE - 8, _length >> 29);
+	FRAM_Sha256::store32(_block + FRAM_SHA256_BLOCK_SIZE - 4, bits);
+	FRAM_Sha256::transform(_block);
+
+	for (uint8_t i = 0; i < 8; i++) FRAM_Sha256::store32(digest + 4 * i, _h[i]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chaining value after the last complete block, 32 bytes. It covers
+				the first getLength() & ~63 bytes of the message.
+*/
+/**************************************************************************/
+void FRAM_Sha256::getState(uint8_t state[])
+{
+	for (uint8_t i = 0; i < 8; i++) FRAM_Sha256::store32(state + 4 * i, _h[i]);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restarts from a saved chaining value. The bytes of the message
+				after length & ~63 must be hashed again with update().
+
+    @params[in] state[]
+                The chaining value returned by getState()
+    @params[in] length
+                The message length when it was saved
+*/
+/**************************************************************************/
+void FRAM_Sha256::setState(const uint8_t state[], uint32_t length)
+{
+	for (uint8_t i = 0; i < 8; i++) _h[i] = FRAM_Sha256::load32(state + 4 * i);
+	_length = length & ~((uint32_t) FRAM_SHA256_BLOCK_SIZE - 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes hashed
+*/
+/**************************************************************************/
+uint32_t FRAM_Sha256::getLength(void)
+{
+	return _length;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Compresses one block, the message schedule is kept in a rolling
+				window of 16 words
+*/
+/**************************************************************************/
+void FRAM_Sha256::transform(const uint8_t *block)
+{
+	uint32_t w[16];
+	uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3];
+	uint32_t e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+	uint32_t t1, t2, s0, s1;
+
+	for (uint8_t i = 0; i < 64; i++) {
+		if (i < 16) {
+			w[i] = FRAM_Sha256::load32(block + 4 * i);
+		}
+		else {
+			s0 = w[(i + 1) & 15];
+			s0 = ROTR(s0, 7) ^ ROTR(s0, 18) ^ (s0 >> 3);
+			s1 = w[(i + 14) & 15];
+			s1 = ROTR(s1, 17) ^ ROTR(s1, 19) ^ (s1 >> 10);
+			w[i & 15] += s0 + s1 + w[(i + 9) & 15];
+		}
+		t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i & 15];
+		t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	_h[0] += a;
+	_h[1] += b;
+	_h[2] += c;
+	_h[3] += d;
+	_h[4] += e;
+	_h[5] += f;
+	_h[6] += g;
+	_h[7] += h;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Big endian word store
+*/
+/**************************************************************************/
+void FRAM_Sha256::store32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) (value >> 24);
+	bytes[1] = (uint8_t) (value >> 16);
+	bytes[2] = (uint8_t) (value >> 8);
+	bytes[3] = (uint8_t) value;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Big endian word load
+*/
+/**************************************************************************/
+uint32_t FRAM_Sha256::load32(const uint8_t *bytes)
+{
+	return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
@@ -0,0 +1,73 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sha256.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Streaming SHA-256 (FIPS 180-4) for image verification. The chaining
+	value can be saved and restored at block boundaries so that a hash
+	interrupted by a reset resumes without reading the data again.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_SHA256_H_
+#define _FRAM_SHA256_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+#define FRAM_SHA256_BLOCK_SIZE 64
+#define FRAM_SHA256_DIGEST_SIZE 32
+
+class FRAM_Sha256 {
+ public:
+	FRAM_Sha256(void);
+
+	void	begin(void);
+	void	update(const uint8_t *data, uint16_t len);
+	void	finish(uint8_t digest[]);
+	void	getState(uint8_t state[]);
+	void	setState(const uint8_t state[], uint32_t length);
+	uint32_t	getLength(void);
+
+ private:
+	uint32_t	_h[8];
+	uint8_t	_block[FRAM_SHA256_BLOCK_SIZE];
+	uint32_t	_length;
+
+	void	transform(const uint8_t *block);
+	static void	store32(uint8_t *bytes, uint32_t value);
+	static uint32_t	load32(const uint8_t *bytes);
+};
+
+#endif
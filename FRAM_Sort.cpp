@@ -0,0 +1,408 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sort.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    External merge sort of fixed size records stored in FRAM.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Sort.h"
+
+#define RECORD_ADDR(base, index, size) ((uint16_t) ((base) + (uint32_t) (index) * (size)))
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Sorts records through a scratch region. Runs of the buffer size
+				are sorted in RAM, then merged two by two between the region
+				and the scratch region: the buffer is split in two input and
+				one output parts, each refilled or flushed with one burst
+				sequence. The result is copied back if the last pass ends in
+				the scratch region. Not stable.
+
+    @params[in] fram
+                The FRAM chip holding the records
+    @params[in] framAddr
+                The 16-bit address of the first record
+    @params[in] count
+                The number of records
+    @params[in] recordSize
+                The size of a record in bytes
+    @params[in] key
+                Returns the sort key of a record
+    @params[in] buffer
+                RAM work buffer, at least 3 records
+    @params[in] bufferSize
+                The size of the buffer in bytes
+    @params[in] scratchAddr
+                The 16-bit address of the scratch region, count x recordSize bytes
+    @returns
+					0: success
+					8: no record or record size null
+					10: buffer smaller than 3 records, or scratch overlapping the records
+					11: records or scratch region out of range
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Sort::sort(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t bufferSize, uint16_t scratchAddr)
+{
+	byte result = FRAM_Sort::checkArgs(fram, framAddr, count, recordSize, bufferSize);
+	if (result != ERROR_0) return result;
+
+	uint32_t len = (uint32_t) count * recordSize;
+	if (((uint32_t) scratchAddr + len) > fram->getMaxAddress()) return ERROR_11;
+	if ((scratchAddr < ((uint32_t) framAddr + len)) && (((uint32_t) scratchAddr + len) > framAddr)) return ERROR_10;
+
+	uint16_t capacity = bufferSize / recordSize;
+	result = FRAM_Sort::sortRuns(fram, framAddr, count, recordSize, key, buffer, capacity);
+
+	uint16_t src = framAddr;
+	uint16_t dst = scratchAddr;
+	uint16_t swap, mid, hi;
+	uint32_t lo;
+	for (uint32_t run = capacity; (run < count) && (result == ERROR_0); run *= 2) {
+		for (lo = 0; (lo < count) && (result == ERROR_0); lo += 2 * run) {
+			mid = ((lo + run) < count) ? (uint16_t) (lo + run) : count;
+			hi = ((lo + 2 * run) < count) ? (uint16_t) (lo + 2 * run) : count;
+			result = FRAM_Sort::merge(fram, src, dst, (uint16_t) lo, mid, hi, recordSize, key, buffer, capacity / 3);
+		}
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if ((result == ERROR_0) && (src != framAddr)) result = FRAM_MB85RC_I2C::copy(fram, src, fram, framAddr, len);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sorts records without scratch region. Runs of the buffer size
+				are sorted in RAM, then merged in place: the merge splits both
+				runs, swaps the middle blocks with a rotation and recurses,
+				down to ranges fitting the buffer which are sorted in RAM.
+				Slower than sort() with a scratch region. Not stable.
+
+    @params[in] fram
+                The FRAM chip holding the records
+    @params[in] framAddr
+                The 16-bit address of the first record
+    @params[in] count
+                The number of records
+    @params[in] recordSize
+                The size of a record in bytes
+    @params[in] key
+                Returns the sort key of a record
+    @params[in] buffer
+                RAM work buffer, at least 3 records
+    @params[in] bufferSize
+                The size of the buffer in bytes
+    @returns
+					0: success
+					8: no record or record size null
+					10: buffer smaller than 3 records
+					11: records out of range
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Sort::sortInPlace(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t bufferSize)
+{
+	byte result = FRAM_Sort::checkArgs(fram, framAddr, count, recordSize, bufferSize);
+	if (result != ERROR_0) return result;
+
+	uint16_t capacity = bufferSize / recordSize;
+	result = FRAM_Sort::sortRuns(fram, framAddr, count, recordSize, key, buffer, capacity);
+
+	uint16_t mid, hi;
+	uint32_t lo;
+	for (uint32_t run = capacity; (run < count) && (result == ERROR_0); run *= 2) {
+		for (lo = 0; ((lo + run) < count) && (result == ERROR_0); lo += 2 * run) {
+			mid = (uint16_t) (lo + run);
+			hi = ((lo + 2 * run) < count) ? (uint16_t) (lo + 2 * run) : count;
+			result = FRAM_Sort::mergeInPlace(fram, framAddr, (uint16_t) lo, mid, hi, recordSize, key, buffer, capacity);
+		}
+	}
+	return result;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Checks the parameters common to both sorts
+*/
+/**************************************************************************/
+byte FRAM_Sort::checkArgs(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, uint16_t bufferSize)
+{
+	if ((count == 0) || (recordSize == 0)) return ERROR_8;
+	if ((bufferSize / recordSize) < 3) return ERROR_10;
+	if (((uint32_t) framAddr + (uint32_t) count * recordSize) > fram->getMaxAddress()) return ERROR_11;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sorts consecutive runs of capacity records in RAM
+*/
+/**************************************************************************/
+byte FRAM_Sort::sortRuns(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t capacity)
+{
+	byte result = ERROR_0;
+	uint16_t n;
+	for (uint32_t lo = 0; (lo < count) && (result == ERROR_0); lo += capacity) {
+		n = ((count - lo) > capacity) ? capacity : (uint16_t) (count - lo);
+		result = fram->readBlock(RECORD_ADDR(framAddr, lo, recordSize), n * recordSize, buffer);
+		if (result != ERROR_0) break;
+		FRAM_Sort::heapSort(buffer, n, recordSize, key);
+		result = fram->writeBlock(RECORD_ADDR(framAddr, lo, recordSize), n * recordSize, buffer);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Heap sort of records in RAM, no extra memory
+*/
+/**************************************************************************/
+void FRAM_Sort::heapSort(uint8_t *records, uint16_t count, uint8_t recordSize, FRAM_SortKey key)
+{
+	if (count < 2) return;
+	for (uint16_t root = count / 2; root > 0; root--) {
+		FRAM_Sort::siftDown(records, root - 1, count, recordSize, key);
+	}
+	for (uint16_t end = count - 1; end > 0; end--) {
+		FRAM_Sort::swap(records, records + end * recordSize, recordSize);
+		FRAM_Sort::siftDown(records, 0, end, recordSize, key);
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restores the max-heap property below a record
+*/
+/**************************************************************************/
+void FRAM_Sort::siftDown(uint8_t *records, uint16_t root, uint16_t count, uint8_t recordSize, FRAM_SortKey key)
+{
+	uint32_t child;
+	while ((child = 2UL * root + 1) < count) {
+		if (((child + 1) < count) && (key(records + child * recordSize) < key(records + (child + 1) * recordSize))) child++;
+		if (key(records + root * recordSize) >= key(records + child * recordSize)) return;
+		FRAM_Sort::swap(records + root * recordSize, records + child * recordSize, recordSize);
+		root = (uint16_t) child;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Swaps two records in RAM
+*/
+/**************************************************************************/
+void FRAM_Sort::swap(uint8_t *a, uint8_t *b, uint8_t size)
+{
+	uint8_t t;
+	while (size--) {
+		t = *a;
+		*a++ = *b;
+		*b++ = t;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Merges the sorted runs [lo, mid) and [mid, hi) of src into dst.
+				Inputs are refilled and the output flushed by part records.
+*/
+/**************************************************************************/
+byte FRAM_Sort::merge(FRAM_MB85RC_I2C *fram, uint16_t src, uint16_t dst, uint16_t lo, uint16_t mid, uint16_t hi, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t part)
+{
+	if (mid >= hi) return FRAM_MB85RC_I2C::copy(fram, RECORD_ADDR(src, lo, recordSize), fram, RECORD_ADDR(dst, lo, recordSize), (uint32_t) (hi - lo) * recordSize);
+
+	uint8_t *inA = buffer;
+	uint8_t *inB = buffer + part * recordSize;
+	uint8_t *out = buffer + 2 * part * recordSize;
+	uint16_t a = lo, b = mid, o = lo;
+	uint16_t aLen = 0, aPos = 0, bLen = 0, bPos = 0, outLen = 0;
+	uint8_t *record;
+	byte result = ERROR_0;
+
+	while (result == ERROR_0) {
+		if ((aPos == aLen) && (a < mid)) {
+			aLen = ((mid - a) > part) ? part : (mid - a);
+			result = fram->readBlock(RECORD_ADDR(src, a, recordSize), aLen * recordSize, inA);
+			a += aLen;
+			aPos = 0;
+		}
+		if ((bPos == bLen) && (b < hi) && (result == ERROR_0)) {
+			bLen = ((hi - b) > part) ? part : (hi - b);
+			result = fram->readBlock(RECORD_ADDR(src, b, recordSize), bLen * recordSize, inB);
+			b += bLen;
+			bPos = 0;
+		}
+		if (result != ERROR_0) break;
+		if ((aPos == aLen) && (bPos == bLen)) break;
+
+		if ((bPos == bLen) || ((aPos < aLen) && (key(inA + aPos * recordSize) <= key(inB + bPos * recordSize)))) {
+			record = inA + (aPos++) * recordSize;
+		}
+		else {
+			record = inB + (bPos++) * recordSize;
+		}
+		memcpy(out + (outLen++) * recordSize, record, recordSize);
+		if (outLen == part) {
+			result = fram->writeBlock(RECORD_ADDR(dst, o, recordSize), outLen * recordSize, out);
+			o += outLen;
+			outLen = 0;
+		}
+	}
+	if ((result == ERROR_0) && (outLen != 0)) result = fram->writeBlock(RECORD_ADDR(dst, o, recordSize), outLen * recordSize, out);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Merges the sorted runs [lo, mid) and [mid, hi) in place
+*/
+/**************************************************************************/
+byte FRAM_Sort::mergeInPlace(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t lo, uint16_t mid, uint16_t hi, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t capacity)
+{
+	uint32_t k1, k2, pivot, probe;
+	uint16_t cut1, cut2, low, high, middle, newMid;
+	byte result = ERROR_0;
+
+	while ((lo < mid) && (mid < hi) && (result == ERROR_0)) {
+		if ((hi - lo) <= capacity) {
+			result = fram->readBlock(RECORD_ADDR(framAddr, lo, recordSize), (hi - lo) * recordSize, buffer);
+			if (result != ERROR_0) break;
+			FRAM_Sort::heapSort(buffer, hi - lo, recordSize, key);
+			return fram->writeBlock(RECORD_ADDR(framAddr, lo, recordSize), (hi - lo) * recordSize, buffer);
+		}
+
+		result = FRAM_Sort::readKey(fram, framAddr, mid - 1, recordSize, key, buffer, &k1);
+		if (result == ERROR_0) result = FRAM_Sort::readKey(fram, framAddr, mid, recordSize, key, buffer, &k2);
+		if ((result != ERROR_0) || (k1 <= k2)) break;
+
+		// split the longer run in its middle, binary search the cut of the other one
+		if ((mid - lo) >= (hi - mid)) {
+			cut1 = lo + (mid - lo) / 2;
+			result = FRAM_Sort::readKey(fram, framAddr, cut1, recordSize, key, buffer, &pivot);
+			low = mid;
+			high = hi;
+			while ((low < high) && (result == ERROR_0)) {
+				middle = low + (high - low) / 2;
+				result = FRAM_Sort::readKey(fram, framAddr, middle, recordSize, key, buffer, &probe);
+				if (probe < pivot) low = middle + 1;
+				else high = middle;
+			}
+			cut2 = low;
+		}
+		else {
+			cut2 = mid + (hi - mid) / 2;
+			result = FRAM_Sort::readKey(fram, framAddr, cut2, recordSize, key, buffer, &pivot);
+			low = lo;
+			high = mid;
+			while ((low < high) && (result == ERROR_0)) {
+				middle = low + (high - low) / 2;
+				result = FRAM_Sort::readKey(fram, framAddr, middle, recordSize, key, buffer, &probe);
+				if (probe <= pivot) low = middle + 1;
+				else high = middle;
+			}
+			cut1 = low;
+		}
+		if (result != ERROR_0) break;
+
+		result = FRAM_Sort::rotate(fram, framAddr, cut1, mid, cut2, recordSize, buffer, capacity);
+		if (result != ERROR_0) break;
+		newMid = cut1 + (cut2 - mid);
+		result = FRAM_Sort::mergeInPlace(fram, framAddr, lo, cut1, newMid, recordSize, key, buffer, capacity);
+		lo = newMid;
+		mid = cut2;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Swaps the blocks [first, middle) and [middle, last). A block
+				fitting the buffer is saved while the other one is moved,
+				otherwise the rotation is made of three reversals.
+*/
+/**************************************************************************/
+byte FRAM_Sort::rotate(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t first, uint16_t middle, uint16_t last, uint8_t recordSize, uint8_t *buffer, uint16_t capacity)
+{
+	uint16_t n1 = middle - first;
+	uint16_t n2 = last - middle;
+	byte result;
+
+	if ((n1 == 0) || (n2 == 0)) return ERROR_0;
+	if (n1 <= capacity) {
+		result = fram->readBlock(RECORD_ADDR(framAddr, first, recordSize), n1 * recordSize, buffer);
+		if (result == ERROR_0) result = FRAM_MB85RC_I2C::copy(fram, RECORD_ADDR(framAddr, middle, recordSize), fram, RECORD_ADDR(framAddr, first, recordSize), (uint32_t) n2 * recordSize);
+		if (result == ERROR_0) result = fram->writeBlock(RECORD_ADDR(framAddr, first + n2, recordSize), n1 * recordSize, buffer);
+		return result;
+	}
+	if (n2 <= capacity) {
+		result = fram->readBlock(RECORD_ADDR(framAddr, middle, recordSize), n2 * recordSize, buffer);
+		if (result == ERROR_0) result = FRAM_MB85RC_I2C::copy(fram, RECORD_ADDR(framAddr, first, recordSize), fram, RECORD_ADDR(framAddr, first + n2, recordSize), (uint32_t) n1 * recordSize);
+		if (result == ERROR_0) result = fram->writeBlock(RECORD_ADDR(framAddr, first, recordSize), n2 * recordSize, buffer);
+		return result;
+	}
+	result = FRAM_Sort::reverse(fram, framAddr, first, middle, recordSize, buffer, capacity);
+	if (result == ERROR_0) result = FRAM_Sort::reverse(fram, framAddr, middle, last, recordSize, buffer, capacity);
+	if (result == ERROR_0) result = FRAM_Sort::reverse(fram, framAddr, first, last, recordSize, buffer, capacity);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reverses the order of the records [first, last), swapping groups
+				of records from both ends through the two halves of the buffer
+*/
+/**************************************************************************/
+byte FRAM_Sort::reverse(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t first, uint16_t last, uint8_t recordSize, uint8_t *buffer, uint16_t capacity)
+{
+	uint16_t half = capacity / 2;
+	uint8_t *head = buffer;
+	uint8_t *tail = buffer + half * recordSize;
+	uint16_t k, i;
+	byte result = ERROR_0;
+
+	while (((last - first) >= 2) && (result == ERROR_0)) {
+		k = (last - first) / 2;
+		if (k > half) k = half;
+		result = fram->readBlock(RECORD_ADDR(framAddr, first, recordSize), k * recordSize, head);
+		if (result == ERROR_0) result = fram->readBlock(RECORD_ADDR(framAddr, last - k, recordSize), k * recordSize, tail);
+		if (result != ERROR_0) break;
+		for (i = 0; i < k / 2; i++) {
+			FRAM_Sort::swap(head + i * recordSize, head + (k - 1 - i) * recordSize, recordSize);
+			FRAM_Sort::swap(tail + i * recordSize, tail + (k - 1 - i) * recordSize, recordSize);
+		}
+		result = fram->writeBlock(RECORD_ADDR(framAddr, first, recordSize), k * recordSize, tail);
+		if (result == ERROR_0) result = fram->writeBlock(RECORD_ADDR(framAddr, last - k, recordSize), k * recordSize, head);
+		first += k;
+		last -= k;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads a record and extracts its key
+*/
+/**************************************************************************/
+byte FRAM_Sort::readKey(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t index, uint8_t recordSize, FRAM_SortKey key, uint8_t *record, uint32_t *value)
+{
+	byte result = fram->readBlock(RECORD_ADDR(framAddr, index, recordSize), recordSize, record);
+	if (result == ERROR_0) *value = key(record);
+	return result;
+}
@@ -0,0 +1,71 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sort.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    External sort of fixed size records stored in FRAM with a bounded RAM
+	buffer provided by the caller. Runs fitting the buffer are sorted in RAM,
+	then merged through a scratch region by sequential bursts, or in place by
+	block rotations when no scratch region is available.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_SORT_H_
+#define _FRAM_SORT_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Key extractor, records are sorted by ascending key
+typedef uint32_t (*FRAM_SortKey)(const uint8_t *record);
+
+class FRAM_Sort {
+ public:
+	static byte	sort(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t bufferSize, uint16_t scratchAddr);
+	static byte	sortInPlace(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t bufferSize);
+
+ private:
+	static byte	checkArgs(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, uint16_t bufferSize);
+	static byte	sortRuns(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t count, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t capacity);
+	static void	heapSort(uint8_t *records, uint16_t count, uint8_t recordSize, FRAM_SortKey key);
+	static void	siftDown(uint8_t *records, uint16_t root, uint16_t count, uint8_t recordSize, FRAM_SortKey key);
+	static void	swap(uint8_t *a, uint8_t *b, uint8_t size);
+	static byte	merge(FRAM_MB85RC_I2C *fram, uint16_t src, uint16_t dst, uint16_t lo, uint16_t mid, uint16_t hi, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t part);
+	static byte	mergeInPlace(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t lo, uint16_t mid, uint16_t hi, uint8_t recordSize, FRAM_SortKey key, uint8_t *buffer, uint16_t capacity);
+	static byte	rotate(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t first, uint16_t middle, uint16_t last, uint8_t recordSize, uint8_t *buffer, uint16_t capacity);
+	static byte	reverse(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t first, uint16_t last, uint8_t recordSize, uint8_t *buffer, uint16_t capacity);
+	static byte	readKey(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t index, uint8_t recordSize, FRAM_SortKey key, uint8_t *record, uint32_t *value);
+};
+
+#endif
@@ -0,0 +1,394 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Staging.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Firmware image staging area with streaming SHA-256 verification.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Staging.h"
+#include "FRAM_Image.h"
+#include "FRAM_BufferPool.h"
+
+#define FRAM_STAGING_STATE_OFFSET 2
+#define FRAM_STAGING_IMAGE_OFFSET (FRAM_STAGING_HEADER_SIZE + 2 * FRAM_STAGING_PROGRESS_SIZE)
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	capacity is the largest image accepted, the area takes 132 bytes more
+*/
+/**************************************************************************/
+FRAM_Staging::FRAM_Staging(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t capacity)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_capacity = capacity;
+		_state = FRAM_STAGING_EMPTY;
+		_imageSize = 0;
+		_received = 0;
+		_seq = 0;
+		memset(_digest, 0, sizeof(_digest));
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Starts a new update, any staged image is dropped
+
+    @params[in] imageSize
+                The size of the image in bytes
+    @params[in] digest[]
+                The expected SHA-256 of the image, 32 bytes
+    @returns
+					0: success
+					8: image size null
+					11: image larger than the capacity, or area out of the memory map
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::start(uint32_t imageSize, const uint8_t digest[])
+{
+	if (imageSize == 0) return ERROR_8;
+	if (imageSize > _capacity) return ERROR_11;
+	if (((uint32_t) _framAddr + FRAM_Staging::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+
+	// header dropped first: a reset during start() leaves no update
+	byte result = FRAM_Staging::setState(FRAM_STAGING_EMPTY);
+	if (result == ERROR_0) result = _fram->fill(_framAddr + FRAM_STAGING_HEADER_SIZE, 2 * FRAM_STAGING_PROGRESS_SIZE, 0x00);
+	if (result != ERROR_0) return result;
+
+	uint8_t header[FRAM_STAGING_HEADER_SIZE];
+	header[0] = 'F';
+	header[1] = 'W';
+	header[FRAM_STAGING_STATE_OFFSET] = FRAM_STAGING_RECEIVING;
+	header[3] = 0;
+	FRAM_Staging::store32(header + 4, imageSize);
+	memcpy(header + 8, digest, FRAM_SHA256_DIGEST_SIZE);
+	FRAM_Staging::store32(header + 40, FRAM_Image::crc32Update(0, header + 4, 36));
+	result = _fram->writeBlock(_framAddr, FRAM_STAGING_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+
+	_state = FRAM_STAGING_RECEIVING;
+	_imageSize = imageSize;
+	_received = 0;
+	_seq = 0;
+	memcpy(_digest, digest, FRAM_SHA256_DIGEST_SIZE);
+	_sha.begin();
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reloads the update found at boot. While receiving, the hash is
+				restored from the newest progress copy and the tail of the last
+				incomplete block is read back from the image.
+
+    @params[out] *offset
+                The image offset to send next, the image size once received
+    @returns
+					0: success, see getState()
+					12: corrupted header or progress
+					15: no update staged
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::resume(uint32_t *offset)
+{
+	uint8_t header[FRAM_STAGING_HEADER_SIZE];
+	byte result = _fram->readBlock(_framAddr, FRAM_STAGING_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+
+	_state = FRAM_STAGING_EMPTY;
+	if ((header[0] != 'F') || (header[1] != 'W') || (header[FRAM_STAGING_STATE_OFFSET] == FRAM_STAGING_EMPTY)) return ERROR_15;
+	if (FRAM_Staging::load32(header + 40) != FRAM_Image::crc32Update(0, header + 4, 36)) return ERROR_12;
+	_imageSize = FRAM_Staging::load32(header + 4);
+	if ((_imageSize == 0) || (_imageSize > _capacity)) return ERROR_12;
+	memcpy(_digest, header + 8, FRAM_SHA256_DIGEST_SIZE);
+
+	if (header[FRAM_STAGING_STATE_OFFSET] != FRAM_STAGING_RECEIVING) {
+		_state = header[FRAM_STAGING_STATE_OFFSET];
+		_received = _imageSize;
+		*offset = _received;
+		return ERROR_0;
+	}
+
+	uint8_t state[2][FRAM_SHA256_DIGEST_SIZE];
+	uint32_t seq[2], received[2];
+	byte valid[2];
+	for (uint8_t copy = 0; copy < 2; copy++) {
+		valid[copy] = FRAM_Staging::readProgress(copy, &seq[copy], &received[copy], state[copy]);
+		if ((valid[copy] != ERROR_0) && (valid[copy] != ERROR_12)) return valid[copy];
+		if (received[copy] > _imageSize) valid[copy] = ERROR_12;
+	}
+
+	_sha.begin();
+	_seq = 0;
+	_received = 0;
+	int8_t newest = -1;
+	if (valid[0] == ERROR_0) newest = 0;
+	if ((valid[1] == ERROR_0) && ((newest < 0) || (seq[1] > seq[0]))) newest = 1;
+	if (newest >= 0) {
+		_seq = seq[newest];
+		_received = received[newest];
+		_sha.setState(state[newest], _received);
+		result = FRAM_Staging::hashImage(&_sha, _sha.getLength(), _received);
+		if (result != ERROR_0) return result;
+	}
+	_state = FRAM_STAGING_RECEIVING;
+	*offset = _received;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stores the next chunk of the image with one burst sequence,
+				hashes it and saves the progress
+
+    @params[in] data[]
+                The chunk
+    @params[in] len
+                The number of bytes of the chunk
+    @returns
+					0: success
+					8: length null
+					10: no update receiving, see start() and resume()
+					11: chunk beyond the image size
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::write(const uint8_t data[], uint16_t len)
+{
+	if (_state != FRAM_STAGING_RECEIVING) return ERROR_10;
+	if (len == 0) return ERROR_8;
+	if ((_received + len) > _imageSize) return ERROR_11;
+
+	byte result = _fram->writeBlock(FRAM_Staging::getImageAddr() + (uint16_t) _received, len, (uint8_t *) data);
+	if (result != ERROR_0) return result;
+	_sha.update(data, len);
+	_received += len;
+	return FRAM_Staging::saveProgress();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the streaming hash once the whole image is received
+
+    @returns
+					0: digest matches, state RECEIVED
+					10: not receiving or image incomplete
+					12: digest mismatch, state FAILED
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::finish(void)
+{
+	if ((_state != FRAM_STAGING_RECEIVING) || (_received != _imageSize)) return ERROR_10;
+
+	uint8_t digest[FRAM_SHA256_DIGEST_SIZE];
+	FRAM_Sha256 sha = _sha;
+	sha.finish(digest);
+	if (memcmp(digest, _digest, FRAM_SHA256_DIGEST_SIZE) != 0) {
+		FRAM_Staging::setState(FRAM_STAGING_FAILED);
+		return ERROR_12;
+	}
+	return FRAM_Staging::setState(FRAM_STAGING_RECEIVED);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the stored image back by bursts and checks its SHA-256,
+				typically just before installing it
+
+    @returns
+					0: digest matches, state VERIFIED
+					10: image not received
+					12: digest mismatch, state FAILED
+					14: transfer buffer pool exhausted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::verify(void)
+{
+	if ((_state != FRAM_STAGING_RECEIVED) && (_state != FRAM_STAGING_VERIFIED)) return ERROR_10;
+
+	uint8_t digest[FRAM_SHA256_DIGEST_SIZE];
+	FRAM_Sha256 sha;
+	byte result = FRAM_Staging::hashImage(&sha, 0, _imageSize);
+	if (result != ERROR_0) return result;
+	sha.finish(digest);
+	if (memcmp(digest, _digest, FRAM_SHA256_DIGEST_SIZE) != 0) {
+		FRAM_Staging::setState(FRAM_STAGING_FAILED);
+		return ERROR_12;
+	}
+	return FRAM_Staging::setState(FRAM_STAGING_VERIFIED);
+}
+
+/**************************************************************************/
+/*!
+    @brief  FRAM_STAGING_EMPTY, _RECEIVING, _RECEIVED, _VERIFIED or _FAILED
+*/
+/**************************************************************************/
+uint8_t FRAM_Staging::getState(void)
+{
+	return _state;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of image bytes stored
+*/
+/**************************************************************************/
+uint32_t FRAM_Staging::getReceived(void)
+{
+	return _received;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Size of the image being staged
+*/
+/**************************************************************************/
+uint32_t FRAM_Staging::getImageSize(void)
+{
+	return _imageSize;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of the first image byte, for the installer
+*/
+/**************************************************************************/
+uint16_t FRAM_Staging::getImageAddr(void)
+{
+	return _framAddr + FRAM_STAGING_IMAGE_OFFSET;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes used on the chip: header, progress and image
+*/
+/**************************************************************************/
+uint32_t FRAM_Staging::getAreaSize(void)
+{
+	return FRAM_STAGING_IMAGE_OFFSET + _capacity;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Writes the state byte of the header
+*/
+/**************************************************************************/
+byte FRAM_Staging::setState(uint8_t state)
+{
+	byte result = _fram->writeByte(_framAddr + FRAM_STAGING_STATE_OFFSET, state);
+	if (result == ERROR_0) _state = state;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Saves the bytes received and the chaining value to the copy not
+				holding the newest progress
+*/
+/**************************************************************************/
+byte FRAM_Staging::saveProgress(void)
+{
+	uint8_t progress[FRAM_STAGING_PROGRESS_SIZE];
+	uint32_t seq = _seq + 1;
+	FRAM_Staging::store32(progress, seq);
+	FRAM_Staging::store32(progress + 4, _received);
+	_sha.getState(progress + 8);
+	FRAM_Staging::store32(progress + 40, FRAM_Image::crc32Update(0, progress, 40));
+
+	byte result = _fram->writeBlock(_framAddr + FRAM_STAGING_HEADER_SIZE + (seq & 1) * FRAM_STAGING_PROGRESS_SIZE, FRAM_STAGING_PROGRESS_SIZE, progress);
+	if (result == ERROR_0) _seq = seq;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads a progress copy
+
+    @returns
+					0: valid copy
+					12: CRC mismatch
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Staging::readProgress(uint8_t copy, uint32_t *seq, uint32_t *received, uint8_t state[])
+{
+	uint8_t progress[FRAM_STAGING_PROGRESS_SIZE];
+	byte result = _fram->readBlock(_framAddr + FRAM_STAGING_HEADER_SIZE + copy * FRAM_STAGING_PROGRESS_SIZE, FRAM_STAGING_PROGRESS_SIZE, progress);
+	*seq = 0;
+	*received = 0;
+	if (result != ERROR_0) return result;
+	if (FRAM_Staging::load32(progress + 40) != FRAM_Image::crc32Update(0, progress, 40)) return ERROR_12;
+	*seq = FRAM_Staging::load32(progress);
+	*received = FRAM_Staging::load32(progress + 4);
+	memcpy(state, progress + 8, FRAM_SHA256_DIGEST_SIZE);
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Hashes image bytes [from, to) read by bursts of a pool buffer
+*/
+/**************************************************************************/
+byte FRAM_Staging::hashImage(FRAM_Sha256 *sha, uint32_t from, uint32_t to)
+{
+	if (from >= to) return ERROR_0;
+
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+
+	uint16_t n;
+	byte result = ERROR_0;
+	while ((from < to) && (result == ERROR_0)) {
+		n = ((to - from) > FRAM_POOL_BUFFER_SIZE) ? FRAM_POOL_BUFFER_SIZE : (uint16_t) (to - from);
+		result = _fram->readBlock(FRAM_Staging::getImageAddr() + (uint16_t) from, n, bufferPool.data);
+		if (result == ERROR_0) sha->update(bufferPool.data, n);
+		from += n;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Little endian word store
+*/
+/**************************************************************************/
+void FRAM_Staging::store32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Little endian word load
+*/
+/**************************************************************************/
+uint32_t FRAM_Staging::load32(const uint8_t *bytes)
+{
+	return bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
@@ -0,0 +1,108 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Staging.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Firmware image staging area: the image is received in chunks, each
+	written with one burst while a streaming SHA-256 runs, then verified end
+	to end by reading it back. Progress is saved after each chunk so that an
+	interrupted update resumes where it stopped.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_STAGING_H_
+#define _FRAM_STAGING_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_Sha256.h"
+
+#define FRAM_STAGING_HEADER_SIZE 44
+#define FRAM_STAGING_PROGRESS_SIZE 44
+
+// Update states, stored in the header
+#define FRAM_STAGING_EMPTY 0
+#define FRAM_STAGING_RECEIVING 1
+#define FRAM_STAGING_RECEIVED 2
+#define FRAM_STAGING_VERIFIED 3
+#define FRAM_STAGING_FAILED 4
+
+/*
+	Area layout
+		header					"FW", state, 0, image size (4), expected SHA-256 (32), CRC32 (4)
+		progress A, B			sequence (4), bytes received (4), SHA-256 chaining value (32), CRC32 (4)
+		image
+
+	The header CRC32 covers the image size and the digest, the state byte is
+	rewritten alone. Progress sequence s goes to copy s & 1, a torn copy is
+	rejected by its CRC32 and the other one is used. The chaining value
+	covers the bytes received rounded down to a 64-byte block, the rest is
+	read back from the image on resume.
+*/
+
+class FRAM_Staging {
+ public:
+	FRAM_Staging(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t capacity);
+
+	byte	start(uint32_t imageSize, const uint8_t digest[]);
+	byte	resume(uint32_t *offset);
+	byte	write(const uint8_t data[], uint16_t len);
+	byte	finish(void);
+	byte	verify(void);
+	uint8_t	getState(void);
+	uint32_t	getReceived(void);
+	uint32_t	getImageSize(void);
+	uint16_t	getImageAddr(void);
+	uint32_t	getAreaSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint32_t	_capacity;
+	uint8_t	_state;
+	uint32_t	_imageSize;
+	uint32_t	_received;
+	uint32_t	_seq;
+	uint8_t	_digest[FRAM_SHA256_DIGEST_SIZE];
+	FRAM_Sha256	_sha;
+
+	byte	setState(uint8_t state);
+	byte	saveProgress(void);
+	byte	readProgress(uint8_t copy, uint32_t *seq, uint32_t *received, uint8_t state[]);
+	byte	hashImage(FRAM_Sha256 *sha, uint32_t from, uint32_t to);
+	static void	store32(uint8_t *bytes, uint32_t value);
+	static uint32_t	load32(const uint8_t *bytes);
+};
+
+#endif
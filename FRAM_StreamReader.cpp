@@ -0,0 +1,253 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_StreamReader.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Double buffered streaming reader for fixed-rate consumers.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_StreamReader.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+*/
+/**************************************************************************/
+FRAM_StreamReader::FRAM_StreamReader(FRAM_MB85RC_I2C *fram)
+{
+		_fram = fram;
+		_fill[0] = 0;
+		_fill[1] = 0;
+		_front = 0;
+		_pos = 0;
+		_eof = true;
+		_underruns = 0;
+		_running = false;
+		_repeat = false;
+		_rate = 0;
+		_fillTime = 0;
+		_lateFills = 0;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Starts streaming a memory area. Both buffers are primed before
+			the function returns, so the consumer may start right after.
+
+    @params[in] framAddr
+                The 16-bit address of the first byte to stream
+    @params[in] length
+                The number of bytes to stream
+    @params[in] rate
+                The consumer rate target in bytes per second, 0 if unknown
+    @params[in] repeat
+                true to loop over the memory area until stop() is called
+    @returns
+				0: success
+				8: length null
+				11: memory area out of range
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_StreamReader::start(uint16_t framAddr, uint32_t length, uint32_t rate, boolean repeat)
+{
+	if (length == 0) return ERROR_8;
+	if (((uint32_t) framAddr + length) > _fram->getMaxAddress()) return ERROR_11;
+
+	FRAM_StreamReader::stop();
+	_startAddr = framAddr;
+	_length = length;
+	_offset = 0;
+	_rate = rate;
+	_repeat = repeat;
+	_underruns = 0;
+	_lateFills = 0;
+	_front = 0;
+	_pos = 0;
+	_eof = false;
+
+	byte result = FRAM_StreamReader::fillBuffer(0);
+	if ((result == ERROR_0) && !_eof) result = FRAM_StreamReader::fillBuffer(1);
+	_running = (result == ERROR_0);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops streaming. Subsequent read() calls return false without
+			counting underruns.
+*/
+/**************************************************************************/
+void FRAM_StreamReader::stop(void)
+{
+	noInterrupts();
+	_running = false;
+	_eof = true;
+	_fill[0] = 0;
+	_fill[1] = 0;
+	interrupts();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Refills the buffer released by the consumer. To be called from
+			loop() as often as possible, never from the consumer's ISR.
+
+    @returns
+				0: success or nothing to do
+				other: return code of the burst read
+*/
+/**************************************************************************/
+byte FRAM_StreamReader::service(void)
+{
+	if (!_running || _eof) return ERROR_0;
+
+	uint8_t back = _front ^ 1;
+	if (_fill[back] != 0) return ERROR_0;
+	return FRAM_StreamReader::fillBuffer(back);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets the next byte of the stream. ISR safe.
+
+    @params[out] *value
+				next byte of the stream
+    @returns
+				true: a byte has been read
+				false: no data available (underrun or end of stream)
+*/
+/**************************************************************************/
+boolean FRAM_StreamReader::read(uint8_t *value)
+{
+	uint8_t f = _front;
+	if (_pos >= _fill[f]) {
+		// hand the drained buffer back to service()
+		_fill[f] = 0;
+		if (_fill[f ^ 1] == 0) {
+			if (!_eof) _underruns++;
+			return false;
+		}
+		f ^= 1;
+		_front = f;
+		_pos = 0;
+	}
+	*value = _buffer[f][_pos++];
+	return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tells if data remains to be consumed
+
+    @returns
+				true: streaming in progress
+				false: stopped or whole memory area consumed
+*/
+/**************************************************************************/
+boolean FRAM_StreamReader::isRunning(void)
+{
+	return _running && !(_eof && (_fill[0] == 0) && (_fill[1] == 0));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of read() calls which found both buffers empty since start()
+*/
+/**************************************************************************/
+uint16_t FRAM_StreamReader::getUnderruns(void)
+{
+	noInterrupts();
+	uint16_t underruns = _underruns;
+	interrupts();
+	return underruns;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of burst reads which lasted longer than the buffer period,
+			meaning the rate target cannot be sustained
+*/
+/**************************************************************************/
+uint16_t FRAM_StreamReader::getLateFills(void)
+{
+	return _lateFills;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Duration of the last buffer fill in microseconds
+*/
+/**************************************************************************/
+uint32_t FRAM_StreamReader::getFillTime(void)
+{
+	return _fillTime;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Time in microseconds for the consumer to drain one buffer at the
+			rate target, 0 if no rate has been given
+*/
+/**************************************************************************/
+uint32_t FRAM_StreamReader::getBufferPeriod(void)
+{
+	if (_rate == 0) return 0;
+	return ((uint32_t) FRAM_STREAM_BUFFER_SIZE * 1000000UL) / _rate;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Fills one buffer with the next bytes of the memory area and
+			publishes it to the consumer once complete
+
+    @params[in] index
+				buffer to fill: 0 | 1
+    @returns
+				return code of the burst read
+*/
+/**************************************************************************/
+byte FRAM_StreamReader::fillBuffer(uint8_t index)
+{
+	uint32_t remaining = _length - _offset;
+	uint8_t count = (remaining > FRAM_STREAM_BUFFER_SIZE) ? FRAM_STREAM_BUFFER_SIZE : (uint8_t) remaining;
+
+	uint32_t startTime = micros();
+	byte result = _fram->readBlock(_startAddr + (uint16_t) _offset, count, _buffer[index]);
+	_fillTime = micros() - startTime;
+	if (result != ERROR_0) return result;
+
+	uint32_t period = FRAM_StreamReader::getBufferPeriod();
+	if ((period != 0) && (_fillTime > period)) _lateFills++;
+
+	// publishing the buffer is a single byte store, atomic against the consumer's ISR
+	_fill[index] = count;
+	_offset += count;
+	if (_offset >= _length) {
+		if (_repeat) {
+			_offset = 0;
+		}
+		else {
+			_eof = true;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,90 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_StreamReader.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Double buffered streaming reader for fixed-rate consumers (DAC playback,
+	waveform generators...). The consumer drains one RAM buffer from its ISR
+	while the other one is refilled by a burst read from the main loop.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_STREAMREADER_H_
+#define _FRAM_STREAMREADER_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Size of each of the 2 RAM buffers - max 255
+#ifndef FRAM_STREAM_BUFFER_SIZE
+#define FRAM_STREAM_BUFFER_SIZE 64
+#endif
+
+
+class FRAM_StreamReader {
+ public:
+	FRAM_StreamReader(FRAM_MB85RC_I2C *fram);
+
+	byte	start(uint16_t framAddr, uint32_t length, uint32_t rate, boolean repeat);
+	void	stop(void);
+	byte	service(void);
+	boolean	read(uint8_t *value);
+	boolean	isRunning(void);
+	uint16_t	getUnderruns(void);
+	uint16_t	getLateFills(void);
+	uint32_t	getFillTime(void);
+	uint32_t	getBufferPeriod(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint8_t	_buffer[2][FRAM_STREAM_BUFFER_SIZE];
+	volatile uint8_t	_fill[2];
+	volatile uint8_t	_front;
+	volatile uint8_t	_pos;
+	volatile boolean	_eof;
+	volatile uint16_t	_underruns;
+
+	boolean	_running;
+	boolean	_repeat;
+	uint16_t	_startAddr;
+	uint32_t	_length;
+	uint32_t	_offset;
+	uint32_t	_rate;
+	uint32_t	_fillTime;
+	uint16_t	_lateFills;
+
+	byte	fillBuffer(uint8_t index);
+};
+
+#endif
@@ -0,0 +1,281 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sync.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    rsync-like differential synchronisation between a chip and a remote image.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Sync.h"
+#include "FRAM_BufferPool.h"
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Sends to the remote side the blocks differing from its image
+			(backup of the chip). The remote provides its signatures, the
+			chip content is compared block by block. A bus error ends the
+			session, the remote gets its code in a status byte.
+
+    @params[in] fram
+                The FRAM chip to back up
+    @params[in] link
+                The stream connected to the remote side
+    @params[in] framAddr
+                The 16-bit address of the area to synchronise
+    @params[in] len
+                The number of bytes to synchronise
+    @params[in] blockSize
+                The block size in bytes
+    @params[out] *sentBlocks
+                Number of blocks transferred
+    @returns
+				0: success
+				8: length or block size null
+				11: memory area out of range
+				12: signature not received from the remote side
+				14: transfer buffer pool exhausted
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Sync::sendChanges(FRAM_MB85RC_I2C *fram, Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize, uint16_t *sentBlocks)
+{
+	*sentBlocks = 0;
+	FRAM_PoolBuffer bufferPool;
+	byte result = FRAM_Sync::checkArea(fram, framAddr, len, blockSize);
+	if ((result == ERROR_0) && (bufferPool.data == NULL)) result = ERROR_14;
+	if (result != ERROR_0) return FRAM_Sync::sendError(link, result);
+
+	uint8_t local[FRAM_SYNC_SIGNATURE_SIZE];
+	uint8_t remote[FRAM_SYNC_SIGNATURE_SIZE];
+	uint8_t *buffer = bufferPool.data;
+	uint32_t offset = 0;
+	uint16_t block, done;
+	byte chunk;
+
+	FRAM_Sync::sendHeader(link, framAddr, len, blockSize);
+	while ((offset < len) && (result == ERROR_0)) {
+		block = ((len - offset) > blockSize) ? blockSize : (uint16_t) (len - offset);
+		if (link.readBytes(remote, FRAM_SYNC_SIGNATURE_SIZE) != FRAM_SYNC_SIGNATURE_SIZE) return ERROR_12;
+		result = FRAM_Sync::blockSignature(fram, framAddr + (uint16_t) offset, block, local);
+		if (result != ERROR_0) {
+			FRAM_Sync::sendError(link, result);
+			break;
+		}
+
+		if (memcmp(local, remote, FRAM_SYNC_SIGNATURE_SIZE) == 0) {
+			link.write((uint8_t) FRAM_SYNC_SAME);
+		}
+		else {
+			link.write((uint8_t) FRAM_SYNC_DIFF);
+			for (done = 0; done < block; done += chunk) {
+				chunk = ((block - done) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (block - done);
+				// the remote expects the whole block, the status byte tells if it is valid
+				if (result == ERROR_0) result = fram->readArray(framAddr + (uint16_t) offset + done, chunk, buffer);
+				if (result != ERROR_0) memset(buffer, 0, chunk);
+				link.write(buffer, chunk);
+			}
+			link.write(result);
+			if (result != ERROR_0) break;
+			(*sentBlocks)++;
+		}
+		offset += block;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Receives from the remote side the blocks differing from the chip
+			(restore of a remote image). The chip signatures are sent, the
+			remote answers with the blocks to write. A bus error ends the
+			session, the remote gets its code in a status byte.
+
+    @params[in] fram
+                The FRAM chip to update
+    @params[in] link
+                The stream connected to the remote side
+    @params[in] framAddr
+                The 16-bit address of the area to synchronise
+    @params[in] len
+                The number of bytes to synchronise
+    @params[in] blockSize
+                The block size in bytes
+    @params[out] *receivedBlocks
+                Number of blocks written to the chip
+    @returns
+				0: success
+				8: length or block size null
+				11: memory area out of range
+				12: unexpected answer or truncated block from the remote side
+				14: transfer buffer pool exhausted
+				other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Sync::receiveChanges(FRAM_MB85RC_I2C *fram, Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize, uint16_t *receivedBlocks)
+{
+	*receivedBlocks = 0;
+	FRAM_PoolBuffer bufferPool;
+	byte result = FRAM_Sync::checkArea(fram, framAddr, len, blockSize);
+	if ((result == ERROR_0) && (bufferPool.data == NULL)) result = ERROR_14;
+	if (result != ERROR_0) return FRAM_Sync::sendError(link, result);
+
+	uint8_t local[FRAM_SYNC_SIGNATURE_SIZE];
+	uint8_t *buffer = bufferPool.data;
+	uint32_t offset = 0;
+	uint16_t block, done;
+	byte chunk;
+
+	FRAM_Sync::sendHeader(link, framAddr, len, blockSize);
+	while (true) {
+		block = ((len - offset) > blockSize) ? blockSize : (uint16_t) (len - offset);
+		if ((result == ERROR_0) && (offset < len)) result = FRAM_Sync::blockSignature(fram, framAddr + (uint16_t) offset, block, local);
+		// status of the previous block write and of the signature
+		link.write(result);
+		if ((result != ERROR_0) || (offset >= len)) break;
+		link.write(local, FRAM_SYNC_SIGNATURE_SIZE);
+
+		if (link.readBytes(buffer, 1) != 1) return ERROR_12;
+		if (buffer[0] == FRAM_SYNC_DIFF) {
+			for (done = 0; done < block; done += chunk) {
+				chunk = ((block - done) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (block - done);
+				if (link.readBytes(buffer, chunk) != chunk) return ERROR_12;
+				if (result == ERROR_0) result = fram->writeArray(framAddr + (uint16_t) offset + done, chunk, buffer);
+			}
+			if (result == ERROR_0) (*receivedBlocks)++;
+		}
+		else if (buffer[0] != FRAM_SYNC_SAME) {
+			return ERROR_12;
+		}
+		offset += block;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes the signature of a block over chunked reads
+
+    @params[in] fram
+                The FRAM chip to read
+    @params[in] framAddr
+                The 16-bit address of the block
+    @params[in] len
+                The block size in bytes
+    @params[out] signature[]
+                FRAM_SYNC_SIGNATURE_SIZE bytes: Adler-32 then CRC32, little endian
+    @returns
+				return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_Sync::blockSignature(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t len, uint8_t signature[])
+{
+	FRAM_PoolBuffer bufferPool;
+	if (bufferPool.data == NULL) return ERROR_14;
+	uint8_t *buffer = bufferPool.data;
+	uint32_t adler = 1;
+	uint32_t crc = 0;
+	uint16_t done;
+	byte chunk;
+	byte result = ERROR_0;
+
+	for (done = 0; (done < len) && (result == ERROR_0); done += chunk) {
+		chunk = ((len - done) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - done);
+		result = fram->readArray(framAddr + done, chunk, buffer);
+		adler = FRAM_Sync::adler32Update(adler, buffer, chunk);
+		crc = FRAM_Image::crc32Update(crc, buffer, chunk);
+	}
+	for (uint8_t i = 0; i < 4; i++) {
+		signature[i] = (uint8_t) (adler >> (8 * i));
+		signature[i + 4] = (uint8_t) (crc >> (8 * i));
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Updates an Adler-32 checksum, the rolling checksum used by rsync
+
+    @params[in] adler
+                checksum of the previous data, 1 for the first call
+    @params[in] data
+                The bytes to add
+    @params[in] len
+                The number of bytes
+    @returns
+				Adler-32 including the buffer
+*/
+/**************************************************************************/
+uint32_t FRAM_Sync::adler32Update(uint32_t adler, const uint8_t *data, uint16_t len)
+{
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while (len--) {
+		a += *data++;
+		if (a >= 65521UL) a -= 65521UL;
+		b += a;
+		if (b >= 65521UL) b -= 65521UL;
+	}
+	return (b << 16) | a;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Sends 'E' and the error code which ends the session
+
+    @returns
+				the error code
+*/
+/**************************************************************************/
+byte FRAM_Sync::sendError(Stream &link, byte result)
+{
+	link.write((uint8_t) FRAM_SYNC_ERROR);
+	link.write(result);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the parameters of a synchronisation
+
+    @returns
+				0: success
+				8: length or block size null
+				11: memory area out of range
+*/
+/**************************************************************************/
+byte FRAM_Sync::checkArea(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint16_t blockSize)
+{
+	if ((len == 0) || (blockSize == 0)) return ERROR_8;
+	if (((uint32_t) framAddr + len - 1) >= fram->getMaxAddress()) return ERROR_11;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends the header describing the synchronised area
+*/
+/**************************************************************************/
+void FRAM_Sync::sendHeader(Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize)
+{
+	uint8_t header[FRAM_SYNC_HEADER_SIZE] = {
+		'F', 'R', 'S', 'Y',
+		(uint8_t) framAddr, (uint8_t) (framAddr >> 8),
+		(uint8_t) len, (uint8_t) (len >> 8), (uint8_t) (len >> 16), (uint8_t) (len >> 24),
+		(uint8_t) blockSize, (uint8_t) (blockSize >> 8)
+	};
+	link.write(header, FRAM_SYNC_HEADER_SIZE);
+}
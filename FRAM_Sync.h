@@ -0,0 +1,100 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Sync.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    rsync-like differential synchronisation between a chip and a remote image.
+	Both sides exchange a signature (Adler-32 + CRC32) per block and only the
+	blocks whose signatures differ are transferred over the link.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_SYNC_H_
+#define _FRAM_SYNC_H_
+
+#include "FRAM_MB85RC_I2C.h"
+#include "FRAM_Image.h"
+
+/*
+	Sync protocol - multi-bytes values are little endian
+
+	The device starts with a 12 bytes header
+		4 bytes		magic "FRSY"
+		2 bytes		start address
+		4 bytes		length in bytes
+		2 bytes		block size in bytes
+	or, when the session can not start (bad area, no buffer), with 'E'
+	followed by a status byte.
+
+	Then, for each block in address order
+		sendChanges (chip to remote)
+			remote sends the 8 bytes signature of its block
+			device answers 'S' (same), 'D' followed by the block content and
+			a status byte, or 'E' followed by a status byte
+		receiveChanges (remote to chip)
+			device sends a status byte then, if 0, the 8 bytes signature of
+			its block
+			remote answers 'S' (same) or 'D' followed by the block content
+		and receiveChanges ends with a last status byte once all blocks are
+		written.
+
+	A status byte is 0 or the error code which ended the session. A block
+	following 'D' always has the block size, its content is only valid when
+	the status byte after it is 0.
+	The last block is shorter when the length is not a multiple of the block size.
+	Signature: 4 bytes Adler-32 then 4 bytes CRC32 of the block.
+	The host side is implemented by extras/python/fram.py.
+*/
+#define FRAM_SYNC_HEADER_SIZE 12
+#define FRAM_SYNC_SIGNATURE_SIZE 8
+#define FRAM_SYNC_SAME 'S'
+#define FRAM_SYNC_DIFF 'D'
+#define FRAM_SYNC_ERROR 'E'
+
+
+class FRAM_Sync {
+ public:
+	static byte	sendChanges(FRAM_MB85RC_I2C *fram, Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize, uint16_t *sentBlocks);
+	static byte	receiveChanges(FRAM_MB85RC_I2C *fram, Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize, uint16_t *receivedBlocks);
+	static byte	blockSignature(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t len, uint8_t signature[]);
+	static uint32_t	adler32Update(uint32_t adler, const uint8_t *data, uint16_t len);
+
+ private:
+	static byte	sendError(Stream &link, byte result);
+	static byte	checkArea(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint32_t len, uint16_t blockSize);
+	static void	sendHeader(Stream &link, uint16_t framAddr, uint32_t len, uint16_t blockSize);
+};
+
+#endif
@@ -0,0 +1,433 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_UndoLog.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Undo log with savepoints for rollback of in-place updates.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_UndoLog.h"
+
+#if FRAM_UNDO_BATCH_SIZE < (FRAM_UNDO_RECORD_OVERHEAD + 2)
+#error "FRAM_UNDO_BATCH_SIZE too small to hold one record"
+#endif
+
+#define FRAM_UNDO_IDLE 0
+#define FRAM_UNDO_ACTIVE 1
+#define FRAM_UNDO_MAX_RECORD (((FRAM_UNDO_BATCH_SIZE - FRAM_UNDO_RECORD_OVERHEAD) > 255) ? 255 : (FRAM_UNDO_BATCH_SIZE - FRAM_UNDO_RECORD_OVERHEAD))
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	The log area must not hold data updated through the log
+*/
+/**************************************************************************/
+FRAM_UndoLog::FRAM_UndoLog(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_size = size;
+		_used = 0;
+		_active = false;
+		_sequence = 0;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Opens the log, formats it on first use. A transaction left active
+				by a power loss is rolled back.
+
+    @returns
+					0: success
+					12: log records corrupted, nothing restored from the bad record down
+					16: area too small for the header and one record
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::begin(void)
+{
+	if (_size < (FRAM_UNDO_HEADER_SIZE + FRAM_UNDO_RECORD_OVERHEAD + 2)) return ERROR_16;
+
+	uint8_t header[FRAM_UNDO_HEADER_SIZE];
+	byte result = _fram->readArray(_framAddr, FRAM_UNDO_HEADER_SIZE, header);
+	if (result != ERROR_0) return result;
+
+	_active = false;
+	_used = 0;
+	if ((header[0] != 'U') || (header[1] != 'L')) {
+		header[0] = 'U';
+		header[1] = 'L';
+		header[2] = FRAM_UNDO_IDLE;
+		header[3] = 0;
+		header[4] = 0;
+		header[5] = 0;
+		_sequence = 0;
+		return _fram->writeArray(_framAddr, FRAM_UNDO_HEADER_SIZE, header);
+	}
+	_sequence = header[4] | ((uint16_t) header[5] << 8);
+	if (header[2] != FRAM_UNDO_ACTIVE) return ERROR_0;
+
+	_active = true;
+	result = FRAM_UndoLog::findEnd();
+	if (result != ERROR_0) return result;
+	return FRAM_UndoLog::rollback();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts a transaction. The transaction sequence is bumped before
+				the state is set active, so the records of the previous
+				transaction no longer pass the CRC check.
+
+    @returns
+					0: success
+					10: a transaction is already active
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::start(void)
+{
+	if (_active) return ERROR_10;
+
+	byte result = _fram->writeByte(_framAddr + FRAM_UNDO_HEADER_SIZE, 0);
+	if (result != ERROR_0) return result;
+	_used = 0;
+	uint8_t sequence[2];
+	sequence[0] = (uint8_t) (_sequence + 1);
+	sequence[1] = (uint8_t) ((_sequence + 1) >> 8);
+	result = _fram->writeArray(_framAddr + 4, 2, sequence);
+	if (result != ERROR_0) return result;
+	_sequence++;
+	result = FRAM_UndoLog::setState(FRAM_UNDO_ACTIVE);
+	if (result == ERROR_0) _active = true;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Overwrites bytes in place. The old bytes are read and assembled
+				as undo records in RAM, each batch is written to the log with
+				one burst, then the bytes it covers are overwritten.
+
+    @params[in] framAddr
+                The 16-bit address to write to
+    @params[in] items
+                The number of bytes to write
+    @params[in] values[]
+                The new bytes
+    @returns
+					0: success
+					8: number of bytes null
+					10: no active transaction, or area overlapping the log
+					11: out of memory range
+					16: log full, the bytes already logged have been written - roll back or commit
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::write(uint16_t framAddr, uint16_t items, const uint8_t values[])
+{
+	if (items == 0) return ERROR_8;
+	if (!_active) return ERROR_10;
+	if (((uint32_t) framAddr + items) > _fram->getMaxAddress()) return ERROR_11;
+	if ((framAddr < ((uint32_t) _framAddr + _size)) && (((uint32_t) framAddr + items) > _framAddr)) return ERROR_10;
+
+	uint16_t records = _size - FRAM_UNDO_HEADER_SIZE;
+	uint16_t done = 0;
+	uint16_t applied = 0;
+	uint16_t batchLen = 0;
+	uint16_t piece, room, crc;
+	uint8_t *record;
+	byte result = ERROR_0;
+
+	while ((done < items) && (result == ERROR_0)) {
+		piece = items - done;
+		if (piece > FRAM_UNDO_MAX_RECORD) piece = FRAM_UNDO_MAX_RECORD;
+		room = FRAM_UNDO_BATCH_SIZE - batchLen;
+		if (room < (FRAM_UNDO_RECORD_OVERHEAD + 1)) {
+			piece = 0;
+		}
+		else if (piece > (room - FRAM_UNDO_RECORD_OVERHEAD)) {
+			piece = room - FRAM_UNDO_RECORD_OVERHEAD;
+		}
+		// the end marker needs one byte after the records
+		if (((uint32_t) _used + batchLen + FRAM_UNDO_RECORD_OVERHEAD + 2) > records) {
+			result = ERROR_16;
+			break;
+		}
+		room = records - _used - batchLen - FRAM_UNDO_RECORD_OVERHEAD - 1;
+		if (piece > room) piece = room;
+
+		if (piece == 0) {
+			result = FRAM_UndoLog::appendBatch(batchLen);
+			if (result == ERROR_0) result = _fram->writeBlock(framAddr + applied, done - applied, (uint8_t *) values + applied);
+			applied = done;
+			batchLen = 0;
+			continue;
+		}
+
+		record = _batch + batchLen;
+		record[0] = (uint8_t) piece;
+		record[1] = (uint8_t) (framAddr + done);
+		record[2] = (uint8_t) ((framAddr + done) >> 8);
+		result = _fram->readBlock(framAddr + done, piece, record + 3);
+		crc = FRAM_UndoLog::recordCrc(record, piece);
+		record[piece + 3] = (uint8_t) crc;
+		record[piece + 4] = (uint8_t) (crc >> 8);
+		record[piece + 5] = (uint8_t) piece;
+		batchLen += piece + FRAM_UNDO_RECORD_OVERHEAD;
+		done += piece;
+	}
+
+	if ((batchLen != 0) && ((result == ERROR_0) || (result == ERROR_16))) {
+		byte flush = FRAM_UndoLog::appendBatch(batchLen);
+		if (flush == ERROR_0) flush = _fram->writeBlock(framAddr + applied, done - applied, (uint8_t *) values + applied);
+		if (flush != ERROR_0) result = flush;
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks the current point of the transaction
+
+    @returns
+					savepoint to give to rollbackTo()
+*/
+/**************************************************************************/
+uint16_t FRAM_UndoLog::savepoint(void)
+{
+	return _used;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restores the bytes overwritten since a savepoint, last write
+				first. Each record is dropped from the log once restored: a
+				power loss during the rollback resumes it at the next begin().
+
+    @params[in] savepoint
+                Value returned by savepoint() in the active transaction
+    @returns
+					0: success
+					10: no active transaction
+					11: savepoint beyond the end of the log
+					12: log records corrupted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::rollbackTo(uint16_t savepoint)
+{
+	if (!_active) return ERROR_10;
+	if (savepoint > _used) return ERROR_11;
+
+	uint16_t records = _framAddr + FRAM_UNDO_HEADER_SIZE;
+	uint16_t start, addr, crc;
+	uint8_t len;
+	byte result;
+
+	while (_used > savepoint) {
+		result = _fram->readByte(records + _used - 1, &len);
+		if (result != ERROR_0) return result;
+		if ((len == 0) || ((uint16_t) (len + FRAM_UNDO_RECORD_OVERHEAD) > (_used - savepoint))) return ERROR_12;
+
+		start = _used - len - FRAM_UNDO_RECORD_OVERHEAD;
+		result = _fram->readBlock(records + start, len + FRAM_UNDO_RECORD_OVERHEAD, _batch);
+		if (result != ERROR_0) return result;
+		crc = FRAM_UndoLog::recordCrc(_batch, len);
+		if ((_batch[0] != len) || (_batch[len + 3] != (uint8_t) crc) || (_batch[len + 4] != (uint8_t) (crc >> 8))) return ERROR_12;
+
+		addr = _batch[1] | ((uint16_t) _batch[2] << 8);
+		result = _fram->writeBlock(addr, len, _batch + 3);
+		if (result == ERROR_0) result = _fram->writeByte(records + start, 0);
+		if (result != ERROR_0) return result;
+		_used = start;
+	}
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restores all the bytes overwritten by the transaction and ends it
+
+    @returns
+					see rollbackTo()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::rollback(void)
+{
+	byte result = FRAM_UndoLog::rollbackTo(0);
+	if (result != ERROR_0) return result;
+	result = FRAM_UndoLog::setState(FRAM_UNDO_IDLE);
+	if (result == ERROR_0) _active = false;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Ends the transaction, the in-place updates are kept. A single
+				byte write, it can not be torn.
+
+    @returns
+					0: success
+					10: no active transaction
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::commit(void)
+{
+	if (!_active) return ERROR_10;
+	byte result = FRAM_UndoLog::setState(FRAM_UNDO_IDLE);
+	if (result != ERROR_0) return result;
+	_active = false;
+	_used = 0;
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tells if a transaction is active
+*/
+/**************************************************************************/
+boolean FRAM_UndoLog::isActive(void)
+{
+	return _active;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of log bytes used by the active transaction
+*/
+/**************************************************************************/
+uint16_t FRAM_UndoLog::getUsed(void)
+{
+	return _used;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Size of the log area in bytes
+*/
+/**************************************************************************/
+uint16_t FRAM_UndoLog::getSize(void)
+{
+	return _size;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Writes the assembled records followed by the end marker with one
+				burst sequence
+
+    @returns
+					return code of the burst write
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::appendBatch(uint16_t len)
+{
+	if (len == 0) return ERROR_0;
+	_batch[len] = 0;
+	byte result = _fram->writeBlock(_framAddr + FRAM_UNDO_HEADER_SIZE + _used, len + 1, _batch);
+	if (result == ERROR_0) _used += len;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Walks the records forward to find the end of the log. A torn
+				record ends the log: its bytes had not been overwritten yet.
+				So does a record of an older transaction, its CRC16 being
+				computed with another sequence.
+
+    @returns
+					return code of the burst reads
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::findEnd(void)
+{
+	uint16_t records = _framAddr + FRAM_UNDO_HEADER_SIZE;
+	uint16_t limit = _size - FRAM_UNDO_HEADER_SIZE;
+	uint16_t crc;
+	uint8_t len;
+	byte result;
+
+	_used = 0;
+	while ((_used + FRAM_UNDO_RECORD_OVERHEAD) < limit) {
+		result = _fram->readByte(records + _used, &len);
+		if (result != ERROR_0) return result;
+		if ((len == 0) || (len > FRAM_UNDO_MAX_RECORD) || (((uint32_t) _used + len + FRAM_UNDO_RECORD_OVERHEAD) > limit)) break;
+
+		result = _fram->readBlock(records + _used, len + FRAM_UNDO_RECORD_OVERHEAD, _batch);
+		if (result != ERROR_0) return result;
+		crc = FRAM_UndoLog::recordCrc(_batch, len);
+		if ((_batch[len + 3] != (uint8_t) crc) || (_batch[len + 4] != (uint8_t) (crc >> 8)) || (_batch[len + 5] != len)) break;
+		_used += len + FRAM_UNDO_RECORD_OVERHEAD;
+	}
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the transaction state byte of the header
+*/
+/**************************************************************************/
+byte FRAM_UndoLog::setState(uint8_t state)
+{
+	return _fram->writeByte(_framAddr + 2, state);
+}
+
+/**************************************************************************/
+/*!
+    @brief  CRC16 of a record: the transaction sequence, then the length,
+				address and old bytes
+
+    @params[in] record[]
+                The record, starting with its length byte
+    @params[in] len
+                Number of old bytes in the record
+*/
+/**************************************************************************/
+uint16_t FRAM_UndoLog::recordCrc(const uint8_t record[], uint8_t len)
+{
+	uint8_t sequence[2];
+	sequence[0] = (uint8_t) _sequence;
+	sequence[1] = (uint8_t) (_sequence >> 8);
+	uint16_t crc = FRAM_UndoLog::crc16Update(0xFFFF, sequence, 2);
+	return FRAM_UndoLog::crc16Update(crc, record, (uint16_t) len + 3);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Updates a CRC16 (CCITT, polynomial 0x1021), table-less
+
+    @params[in] crc
+                CRC of the previous data, 0xFFFF for the first call
+*/
+/**************************************************************************/
+uint16_t FRAM_UndoLog::crc16Update(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+	while (len--) {
+		crc ^= (uint16_t) (*data++) << 8;
+		for (uint8_t k = 0; k < 8; k++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
@@ -0,0 +1,102 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_UndoLog.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Undo log for in-place updates: the old bytes are saved in a log area by
+	batched bursts before being overwritten. A transaction is committed,
+	rolled back entirely or to a savepoint, and rolled back by begin() when
+	a power loss interrupted it.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_UNDOLOG_H_
+#define _FRAM_UNDOLOG_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// RAM buffer assembling undo records before they are written with one burst
+#ifndef FRAM_UNDO_BATCH_SIZE
+#define FRAM_UNDO_BATCH_SIZE 64
+#endif
+
+#define FRAM_UNDO_HEADER_SIZE 6
+#define FRAM_UNDO_RECORD_OVERHEAD 6
+
+/*
+	Log layout
+		header		"UL", state (0: idle, 1: transaction active), reserved,
+					transaction sequence (2, little endian)
+		records		length (1), address (2), old bytes, CRC16 (2), length (1)
+		end			a record length of 0 follows the last record
+
+	The trailing length allows walking the records backward for rollback,
+	the CRC16 rejects a record torn by a power loss. The CRC16 covers the
+	transaction sequence, bumped by start(): records left by an older
+	transaction behind a torn batch do not match and end the log.
+*/
+
+class FRAM_UndoLog {
+ public:
+	FRAM_UndoLog(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t size);
+
+	byte	begin(void);
+	byte	start(void);
+	byte	write(uint16_t framAddr, uint16_t items, const uint8_t values[]);
+	uint16_t	savepoint(void);
+	byte	rollbackTo(uint16_t savepoint);
+	byte	rollback(void);
+	byte	commit(void);
+	boolean	isActive(void);
+	uint16_t	getUsed(void);
+	uint16_t	getSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint16_t	_size;
+	uint16_t	_used;
+	boolean	_active;
+	uint16_t	_sequence;
+	uint8_t	_batch[FRAM_UNDO_BATCH_SIZE + 1];
+
+	byte	appendBatch(uint16_t len);
+	byte	findEnd(void);
+	byte	setState(uint8_t state);
+	uint16_t	recordCrc(const uint8_t record[], uint8_t len);
+	static uint16_t	crc16Update(uint16_t crc, const uint8_t *data, uint16_t len);
+};
+
+#endif
@@ -0,0 +1,277 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_VersionStore.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Multi-version records with lock-free snapshot reads.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_VersionStore.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	slots is the number of versions kept per record, 2 at least. More slots
+	let slow readers finish before their version is recycled.
+*/
+/**************************************************************************/
+FRAM_VersionStore::FRAM_VersionStore(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t recordSize, uint16_t records, uint8_t slots)
+{
+		_fram = fram;
+		_framAddr = framAddr;
+		_recordSize = recordSize;
+		_records = records;
+		_slots = (slots < 2) ? 2 : slots;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Sets all records to version 1, filled with 0x00
+
+    @returns
+					0: success
+					8: record size or number of records null
+					11: area out of the memory map
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::format(void)
+{
+	if ((_recordSize == 0) || (_records == 0)) return ERROR_8;
+	if (((uint32_t) _framAddr + FRAM_VersionStore::getAreaSize()) > _fram->getMaxAddress()) return ERROR_11;
+
+	byte result = _fram->fill(_framAddr, FRAM_VersionStore::getAreaSize(), 0x00);
+	for (uint16_t record = 0; (record < _records) && (result == ERROR_0); record++) {
+		result = FRAM_VersionStore::writeStamp(record, 0, 2);
+	}
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stores a new version of a record. The oldest slot is stamped
+				odd, filled, stamped with the new version, then the record
+				pointer is flipped to it with one byte write. A power loss
+				keeps the previous version current.
+				Writers of a same store must not run concurrently.
+
+    @params[in] record
+                The record number
+    @params[in] data[]
+                The record content, record size bytes
+    @returns
+					0: success
+					11: record number out of range
+					12: record pointer corrupted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::write(uint16_t record, const uint8_t data[])
+{
+	if (record >= _records) return ERROR_11;
+
+	uint8_t current;
+	uint32_t stamp;
+	byte result = _fram->readByte(_framAddr + record, &current);
+	if (result != ERROR_0) return result;
+	if (current >= _slots) return ERROR_12;
+	result = FRAM_VersionStore::readStamp(record, current, &stamp);
+	if (result != ERROR_0) return result;
+
+	uint8_t next = (current + 1) % _slots;
+	result = FRAM_VersionStore::writeStamp(record, next, stamp + 1);
+	if (result == ERROR_0) result = _fram->writeBlock(FRAM_VersionStore::slotAddr(record, next) + FRAM_VERSION_STAMP_SIZE, _recordSize, (uint8_t *) data);
+	if (result == ERROR_0) result = FRAM_VersionStore::writeStamp(record, next, stamp + 2);
+	if (result == ERROR_0) result = _fram->writeByte(_framAddr + record, next);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the current version of a record without record lock. The
+				stamp is read again after the data: a slot recycled meanwhile
+				by a writer is detected and the read is retried. Bus access
+				must be serialised with the writer's task by the caller.
+
+    @params[in] record
+                The record number
+    @params[out] data[]
+                The record content, record size bytes
+    @params[out] *version
+                The version read
+    @returns
+					0: success
+					11: record number out of range
+					12: record pointer corrupted
+					17: FRAM_VERSION_RETRIES attempts overtaken by writers
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::read(uint16_t record, uint8_t data[], uint32_t *version)
+{
+	if (record >= _records) return ERROR_11;
+
+	uint8_t current;
+	uint32_t stamp;
+	byte result;
+
+	for (uint8_t attempt = 0; attempt < FRAM_VERSION_RETRIES; attempt++) {
+		result = _fram->readByte(_framAddr + record, &current);
+		if (result != ERROR_0) return result;
+		if (current >= _slots) return ERROR_12;
+		result = FRAM_VersionStore::readStamp(record, current, &stamp);
+		if (result != ERROR_0) return result;
+		if (stamp & 1) continue;
+
+		result = FRAM_VersionStore::readSlot(record, current, stamp, data);
+		if (result == ERROR_17) continue;
+		if (result == ERROR_0) *version = stamp >> 1;
+		return result;
+	}
+	return ERROR_17;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads a given version of a record, while it has not been recycled.
+				Readers needing a stable snapshot across several reads keep the
+				version returned by read().
+
+    @params[in] record
+                The record number
+    @params[in] version
+                The version to read
+    @params[out] data[]
+                The record content, record size bytes
+    @returns
+					0: success
+					11: record number out of range
+					15: version not available any more
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::readVersion(uint16_t record, uint32_t version, uint8_t data[])
+{
+	if (record >= _records) return ERROR_11;
+
+	uint32_t stamp;
+	byte result;
+	for (uint8_t slot = 0; slot < _slots; slot++) {
+		result = FRAM_VersionStore::readStamp(record, slot, &stamp);
+		if (result != ERROR_0) return result;
+		if (stamp != (version << 1)) continue;
+
+		result = FRAM_VersionStore::readSlot(record, slot, stamp, data);
+		return (result == ERROR_17) ? ERROR_15 : result;
+	}
+	return ERROR_15;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Current version of a record, without reading its data
+
+    @returns
+					0: success
+					11: record number out of range
+					12: record pointer corrupted
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::getVersion(uint16_t record, uint32_t *version)
+{
+	if (record >= _records) return ERROR_11;
+
+	uint8_t current;
+	uint32_t stamp;
+	byte result = _fram->readByte(_framAddr + record, &current);
+	if (result != ERROR_0) return result;
+	if (current >= _slots) return ERROR_12;
+	result = FRAM_VersionStore::readStamp(record, current, &stamp);
+	if (result == ERROR_0) *version = stamp >> 1;
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of bytes used on the chip by the store
+*/
+/**************************************************************************/
+uint32_t FRAM_VersionStore::getAreaSize(void)
+{
+	return _records + (uint32_t) _records * _slots * (FRAM_VERSION_STAMP_SIZE + _recordSize);
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Chip address of a version slot, stamp first
+*/
+/**************************************************************************/
+uint16_t FRAM_VersionStore::slotAddr(uint16_t record, uint8_t slot)
+{
+	return _framAddr + _records + (uint16_t) (((uint32_t) record * _slots + slot) * (FRAM_VERSION_STAMP_SIZE + _recordSize));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the stamp of a slot, little endian
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::readStamp(uint16_t record, uint8_t slot, uint32_t *stamp)
+{
+	uint8_t bytes[FRAM_VERSION_STAMP_SIZE];
+	byte result = _fram->readArray(FRAM_VersionStore::slotAddr(record, slot), FRAM_VERSION_STAMP_SIZE, bytes);
+	*stamp = bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+	return result;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the stamp of a slot, little endian
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::writeStamp(uint16_t record, uint8_t slot, uint32_t stamp)
+{
+	uint8_t bytes[FRAM_VERSION_STAMP_SIZE] = {
+		(uint8_t) stamp, (uint8_t) (stamp >> 8), (uint8_t) (stamp >> 16), (uint8_t) (stamp >> 24)
+	};
+	return _fram->writeArray(FRAM_VersionStore::slotAddr(record, slot), FRAM_VERSION_STAMP_SIZE, bytes);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the data of a slot and checks the stamp did not move
+
+    @returns
+					0: consistent copy
+					17: the slot has been rewritten during the read
+					other: return code of Wire.endTransmission()
+*/
+/**************************************************************************/
+byte FRAM_VersionStore::readSlot(uint16_t record, uint8_t slot, uint32_t stamp, uint8_t data[])
+{
+	uint32_t check;
+	byte result = _fram->readBlock(FRAM_VersionStore::slotAddr(record, slot) + FRAM_VERSION_STAMP_SIZE, _recordSize, data);
+	if (result != ERROR_0) return result;
+	result = FRAM_VersionStore::readStamp(record, slot, &check);
+	if (result != ERROR_0) return result;
+	return (check == stamp) ? ERROR_0 : ERROR_17;
+}
@@ -0,0 +1,95 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_VersionStore.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Multi-version records: each record owns a ring of version slots. A writer
+	fills the oldest slot then flips the record pointer with a single byte
+	write, readers take no record lock and detect a slot recycled under them
+	with a sequence stamp (seqlock). Readers and the writer may run in
+	different tasks, but each bus transfer must complete before the next one
+	starts: the caller serialises access to the Wire or SPI bus between tasks
+	(a mutex around each call), and no call may be made from an interrupt
+	handler, which can not run bus transfers.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_VERSIONSTORE_H_
+#define _FRAM_VERSIONSTORE_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+// Attempts of a reader racing with writers before giving up with ERROR_17
+#ifndef FRAM_VERSION_RETRIES
+#define FRAM_VERSION_RETRIES 4
+#endif
+
+#define FRAM_VERSION_STAMP_SIZE 4
+
+/*
+	Area layout
+		pointers	one byte per record: slot holding the current version
+		slots		per record, slots x (stamp + record bytes)
+
+	The 32 bits stamp is odd while the slot is written, 2 x version once
+	complete. Only one writer at a time, readers need no record lock - the
+	bus itself stays serialised by the caller.
+*/
+
+class FRAM_VersionStore {
+ public:
+	FRAM_VersionStore(FRAM_MB85RC_I2C *fram, uint16_t framAddr, uint16_t recordSize, uint16_t records, uint8_t slots);
+
+	byte	format(void);
+	byte	write(uint16_t record, const uint8_t data[]);
+	byte	read(uint16_t record, uint8_t data[], uint32_t *version);
+	byte	readVersion(uint16_t record, uint32_t version, uint8_t data[]);
+	byte	getVersion(uint16_t record, uint32_t *version);
+	uint32_t	getAreaSize(void);
+
+ private:
+	FRAM_MB85RC_I2C	*_fram;
+	uint16_t	_framAddr;
+	uint16_t	_recordSize;
+	uint16_t	_records;
+	uint8_t	_slots;
+
+	uint16_t	slotAddr(uint16_t record, uint8_t slot);
+	byte	readStamp(uint16_t record, uint8_t slot, uint32_t *stamp);
+	byte	writeStamp(uint16_t record, uint8_t slot, uint32_t stamp);
+	byte	readSlot(uint16_t record, uint8_t slot, uint32_t stamp, uint8_t data[]);
+};
+
+#endif
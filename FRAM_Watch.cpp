@@ -0,0 +1,232 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Watch.cpp
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Watch / notify callbacks on address ranges.
+
+    @section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+
+#include "FRAM_Watch.h"
+
+/*========================================================================*/
+/*                            CONSTRUCTORS                                */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    Constructor
+	Attach the watch to one chip with FRAM_MB85RC_I2C::setWatch()
+*/
+/**************************************************************************/
+FRAM_Watch::FRAM_Watch(void)
+{
+		_count = 0;
+		_batchDepth = 0;
+		_dispatching = false;
+}
+
+/*========================================================================*/
+/*                           PUBLIC FUNCTIONS                             */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Registers a handler on an address range. Handlers run in the
+				context of the writer, right after the write: they must be
+				short, must not add or remove watches, and their own writes
+				are not notified.
+
+    @params[in] framAddr
+                The 16-bit address of the range
+    @params[in] len
+                The number of bytes watched
+    @params[in] handler
+                Called with the written part of the range
+    @params[in] context
+                Passed to the handler
+    @returns
+					0: success
+					8: length null
+					11: range beyond the 16-bit address space
+					16: FRAM_WATCH_MAX reached
+*/
+/**************************************************************************/
+byte FRAM_Watch::add(uint16_t framAddr, uint16_t len, FRAM_WatchHandler handler, void *context)
+{
+	if (len == 0) return ERROR_8;
+	if (((uint32_t) framAddr + len) > MAXADDRESS_512) return ERROR_11;
+	if (_count == FRAM_WATCH_MAX) return ERROR_16;
+
+	uint8_t i = _count;
+	while ((i > 0) && (_start[i - 1] > framAddr)) {
+		_start[i] = _start[i - 1];
+		_end[i] = _end[i - 1];
+		_handler[i] = _handler[i - 1];
+		_context[i] = _context[i - 1];
+		_pendingStart[i] = _pendingStart[i - 1];
+		_pendingEnd[i] = _pendingEnd[i - 1];
+		i--;
+	}
+	_start[i] = framAddr;
+	_end[i] = (uint32_t) framAddr + len;
+	_handler[i] = handler;
+	_context[i] = context;
+	_pendingStart[i] = 0;
+	_pendingEnd[i] = 0;
+	_count++;
+	FRAM_Watch::updateMaxEnd();
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Removes the watches of a handler and context starting at an address
+
+    @returns
+					0: success
+					15: no such watch
+*/
+/**************************************************************************/
+byte FRAM_Watch::remove(uint16_t framAddr, FRAM_WatchHandler handler, void *context)
+{
+	uint8_t kept = 0;
+	for (uint8_t i = 0; i < _count; i++) {
+		if ((_start[i] == framAddr) && (_handler[i] == handler) && (_context[i] == context)) continue;
+		_start[kept] = _start[i];
+		_end[kept] = _end[i];
+		_handler[kept] = _handler[i];
+		_context[kept] = _context[i];
+		_pendingStart[kept] = _pendingStart[i];
+		_pendingEnd[kept] = _pendingEnd[i];
+		kept++;
+	}
+	if (kept == _count) return ERROR_15;
+	_count = kept;
+	FRAM_Watch::updateMaxEnd();
+	return ERROR_0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Defers notifications until the matching endBatch(). Batches may
+				be nested.
+*/
+/**************************************************************************/
+void FRAM_Watch::beginBatch(void)
+{
+	_batchDepth++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Ends a batch: each watch touched during the outermost batch is
+				notified once, with the span of the writes it received
+*/
+/**************************************************************************/
+void FRAM_Watch::endBatch(void)
+{
+	if (_batchDepth == 0) return;
+	if (--_batchDepth != 0) return;
+
+	uint32_t start, end;
+	for (uint8_t i = 0; i < _count; i++) {
+		if (_pendingEnd[i] == 0) continue;
+		start = _pendingStart[i];
+		end = _pendingEnd[i];
+		_pendingEnd[i] = 0;
+		FRAM_Watch::dispatch(i, start, end);
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reports a write, called by the driver once per write operation
+
+    @params[in] framAddr
+                The 16-bit address of the first byte written
+    @params[in] len
+                The number of bytes written
+*/
+/**************************************************************************/
+void FRAM_Watch::notify(uint16_t framAddr, uint32_t len)
+{
+	if ((_count == 0) || (len == 0) || _dispatching) return;
+
+	uint32_t start = framAddr;
+	uint32_t end = start + len;
+
+	// watches [0, low) start before the end of the write
+	uint8_t low = 0, high = _count, middle;
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (_start[middle] < end) low = middle + 1;
+		else high = middle;
+	}
+
+	uint32_t first, last;
+	for (uint8_t i = low; (i > 0) && (_maxEnd[i - 1] > start); i--) {
+		if (_end[i - 1] <= start) continue;
+		first = (_start[i - 1] > start) ? _start[i - 1] : start;
+		last = (_end[i - 1] < end) ? _end[i - 1] : end;
+		if (_batchDepth == 0) {
+			FRAM_Watch::dispatch(i - 1, first, last);
+		}
+		else if (_pendingEnd[i - 1] == 0) {
+			_pendingStart[i - 1] = first;
+			_pendingEnd[i - 1] = last;
+		}
+		else {
+			if (first < _pendingStart[i - 1]) _pendingStart[i - 1] = first;
+			if (last > _pendingEnd[i - 1]) _pendingEnd[i - 1] = last;
+		}
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of watches registered
+*/
+/**************************************************************************/
+uint8_t FRAM_Watch::getCount(void)
+{
+	return _count;
+}
+
+/*========================================================================*/
+/*                           PRIVATE FUNCTIONS                            */
+/*========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Rebuilds the running maximum of the end addresses
+*/
+/**************************************************************************/
+void FRAM_Watch::updateMaxEnd(void)
+{
+	uint32_t maxEnd = 0;
+	for (uint8_t i = 0; i < _count; i++) {
+		if (_end[i] > maxEnd) maxEnd = _end[i];
+		_maxEnd[i] = maxEnd;
+	}
+}
+
+/**************************************************************************/
+/*!
+    @brief  Calls a handler, writes made by the handler are not notified.
+				The span is clipped to the watch, whose length fits 16 bits
+				(see add()): a 65536 bytes write, possible with fill(), is
+				never reported as a length of 0.
+*/
+/**************************************************************************/
+void FRAM_Watch::dispatch(uint8_t watch, uint32_t start, uint32_t end)
+{
+	_dispatching = true;
+	_handler[watch]((uint16_t) start, (uint16_t) (end - start), _context[watch]);
+	_dispatching = false;
+}
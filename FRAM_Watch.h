@@ -0,0 +1,92 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_Watch.h
+    @author   SOSAndroid.fr (E. Ha.)
+
+    @section  HISTORY
+
+    v1.0 - First release
+
+    Watch / notify of address ranges: a handler registered on a range is
+	called after writes through the driver touch it, so that tasks need not
+	poll the chip for changes. Writes of a batch, such as a mirror flush,
+	are notified once when the batch ends.
+
+    @section LICENSE
+
+    Software License Agreement (BSD License)
+
+    Copyright (c) 2013, SOSAndroid.fr (E. Ha.)
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+    1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+    3. Neither the name of the copyright holders nor the
+    names of its contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ''AS IS'' AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/**************************************************************************/
+#ifndef _FRAM_WATCH_H_
+#define _FRAM_WATCH_H_
+
+#include "FRAM_MB85RC_I2C.h"
+
+#ifndef FRAM_WATCH_MAX
+#define FRAM_WATCH_MAX 8
+#endif
+
+// Called with the part of the watched range that was written
+typedef void (*FRAM_WatchHandler)(uint16_t framAddr, uint16_t len, void *context);
+
+/*
+	Index
+		Watches are kept sorted by start address with, for each one, the
+		largest end address of the watches up to it. A write [a, b) finds by
+		binary search the last watch starting before b, then walks back while
+		that largest end is above a: only overlapping candidates are visited.
+*/
+
+class FRAM_Watch {
+ public:
+	FRAM_Watch(void);
+
+	byte	add(uint16_t framAddr, uint16_t len, FRAM_WatchHandler handler, void *context);
+	byte	remove(uint16_t framAddr, FRAM_WatchHandler handler, void *context);
+	void	beginBatch(void);
+	void	endBatch(void);
+	void	notify(uint16_t framAddr, uint32_t len);
+	uint8_t	getCount(void);
+
+ private:
+	uint8_t	_count;
+	uint16_t	_start[FRAM_WATCH_MAX];
+	uint32_t	_end[FRAM_WATCH_MAX];
+	uint32_t	_maxEnd[FRAM_WATCH_MAX];
+	FRAM_WatchHandler	_handler[FRAM_WATCH_MAX];
+	void	*_context[FRAM_WATCH_MAX];
+	uint32_t	_pendingStart[FRAM_WATCH_MAX];
+	uint32_t	_pendingEnd[FRAM_WATCH_MAX];
+	uint8_t	_batchDepth;
+	boolean	_dispatching;
+
+	void	updateMaxEnd(void);
+	void	dispatch(uint8_t watch, uint32_t start, uint32_t end);
+};
+
+#endif
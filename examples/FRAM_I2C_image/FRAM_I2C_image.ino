@@ -0,0 +1,61 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_I2C_image.ino
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Sketch to dump the whole chip to Serial and restore an image from Serial.
+	The host captures or sends the binary image with any serial tool, eg. on Linux
+		stty -F /dev/ttyACM0 115200 raw ; cat /dev/ttyACM0 > board.img
+	
+	Send 'd' to dump, 'r' followed by the image to restore.
+	
+	SERIAL_DEBUG must be set to 0 in FRAM_MB85RC_I2C.h, debug messages would corrupt the image.
+
+    @section  HISTORY
+
+    v1.0.0 - First release
+	
+*/
+/**************************************************************************/
+
+#include <Wire.h>
+#include <FRAM_MB85RC_I2C.h>
+#include <FRAM_Image.h>
+
+
+//Creating object for FRAM chip
+FRAM_MB85RC_I2C mymemory;
+
+
+void setup() {
+
+	Serial.begin(115200);
+	while (!Serial) ; //wait until Serial ready
+	Serial.setTimeout(5000);
+	Wire.begin();
+	
+	mymemory.begin();
+}
+
+void loop() {
+	byte result;
+	uint32_t written;
+	
+	if (Serial.available() > 0) {
+		switch (Serial.read()) {
+			case 'd':
+				result = FRAM_Image::dump(&mymemory, Serial);
+				break;
+			case 'r':
+				result = FRAM_Image::restore(&mymemory, Serial, &written);
+				Serial.print("Restore result ");
+				Serial.print(result, DEC);
+				Serial.print(", bytes written ");
+				Serial.println(written, DEC);
+				break;
+			default:
+				break;
+		}
+	}
+}
@@ -0,0 +1,286 @@
+/**************************************************************************/
+/*!
+    @file     FRAM_I2C_tool.ino
+    @author   SOSAndroid (E. Ha.)
+    @license  BSD (see license.txt)
+
+    Serial console to inspect and program a chip without writing a sketch per task.
+	Flash it once, then type commands in any serial terminal (115200 bauds, newline terminated).
+	Numbers may be given in decimal or hexadecimal (0x prefix).
+	
+		probe							read the device IDs and print the chip properties
+		dump <addr> <len>				hexadecimal dump
+		save <addr> <len>				binary image of an area, of the whole chip without arguments (see FRAM_Image.h), then a result line
+		load							restore a binary image sent right after the command, as written by save
+		fill <addr> <len> <value>		fill an area with one value
+		verify <addr> <len> <value>		check an area holds one value
+		crc <addr> <len>				CRC32 of an area
+		bench <addr> <len>				read and write throughput - content is preserved
+		test <addr> <len> <keep>		address lines and March C- self-test, content preserved if keep is 1
+	
+	Addresses above 0xFFFF are rejected with error 11.
+	
+	Binary transfers for host scripts (see extras/python/fram.py), errors are reported in their status bytes
+		read <addr> <len>				answers len raw bytes then 1 status byte
+		write <addr> <len>				expects len raw bytes right after the command, answers 1 status byte
+		syncout <addr> <len> <block>	sends the blocks differing from the host image (FRAM_Sync::sendChanges)
+		syncin <addr> <len> <block>		writes the blocks of the host image differing from the chip (FRAM_Sync::receiveChanges)
+	
+	All transfers use the chunked burst functions (readBlock, writeBlock, fill).
+	SERIAL_DEBUG must be set to 0 in FRAM_MB85RC_I2C.h to keep the output readable.
+
+    @section  HISTORY
+
+    v1.0.0 - First release
+	
+*/
+/**************************************************************************/
+
+#include <Wire.h>
+#include <FRAM_MB85RC_I2C.h>
+#include <FRAM_Image.h>
+#include <FRAM_SelfTest.h>
+#include <FRAM_Sync.h>
+
+
+#define LINE_SIZE 48
+
+//Creating object for FRAM chip
+FRAM_MB85RC_I2C mymemory;
+
+char line[LINE_SIZE];
+uint8_t buffer[FRAM_CHUNK_SIZE];
+
+
+void setup() {
+
+	Serial.begin(115200);
+	while (!Serial) ; //wait until Serial ready
+	Serial.setTimeout(5000);
+	Wire.begin();
+	
+	mymemory.begin();
+	Serial.println("FRAM tool ready");
+}
+
+void loop() {
+	if (Serial.available() > 0) {
+		size_t n = Serial.readBytesUntil('\n', line, LINE_SIZE - 1);
+		line[n] = '\0';
+		if ((n > 0) && (line[n - 1] == '\r')) line[n - 1] = '\0';
+		runCommand();
+	}
+}
+
+uint32_t nextArg(void) {
+	char *arg = strtok(NULL, " ");
+	return (arg == NULL) ? 0 : strtoul(arg, NULL, 0);
+}
+
+void printResult(byte result) {
+	Serial.print("result ");
+	Serial.println(result, DEC);
+}
+
+void runCommand(void) {
+	char *cmd = strtok(line, " ");
+	if (cmd == NULL) return;
+	
+	uint32_t first = nextArg();
+	uint32_t len = nextArg();
+	uint32_t third = nextArg();
+	uint8_t value = (uint8_t) third;
+	// the chip has 16-bit addresses, a larger argument must not wrap around
+	byte check = (first > 0xFFFF) ? ERROR_11 : ERROR_0;
+	uint16_t addr = (uint16_t) first;
+	
+	// binary commands keep their framing whatever happens
+	if (strcmp(cmd, "read") == 0) rawRead(addr, len, check);
+	else if (strcmp(cmd, "write") == 0) rawWrite(addr, len, check);
+	else if (strcmp(cmd, "syncout") == 0) sync(true, addr, len, (uint16_t) third, check);
+	else if (strcmp(cmd, "syncin") == 0) sync(false, addr, len, (uint16_t) third, check);
+	else if (check != ERROR_0) printResult(check);
+	else if (strcmp(cmd, "probe") == 0) probe();
+	else if (strcmp(cmd, "dump") == 0) dump(addr, len);
+	else if (strcmp(cmd, "save") == 0) save(addr, len);
+	else if (strcmp(cmd, "load") == 0) load();
+	else if (strcmp(cmd, "fill") == 0) printResult(mymemory.fill(addr, len, value));
+	else if (strcmp(cmd, "verify") == 0) verify(addr, len, value);
+	else if (strcmp(cmd, "crc") == 0) crc(addr, len);
+	else if (strcmp(cmd, "bench") == 0) bench(addr, len);
+	else if (strcmp(cmd, "test") == 0) selfTest(addr, len, value != 0);
+	else Serial.println("unknown command");
+}
+
+void probe(void) {
+	uint16_t id;
+	byte result = mymemory.checkDevice();
+	printResult(result);
+	mymemory.getOneDeviceID(1, &id);
+	Serial.print("Manufacturer 0x"); Serial.println(id, HEX);
+	mymemory.getOneDeviceID(2, &id);
+	Serial.print("ProductID 0x"); Serial.println(id, HEX);
+	mymemory.getOneDeviceID(3, &id);
+	Serial.print("Density code 0x"); Serial.println(id, HEX);
+	mymemory.getOneDeviceID(4, &id);
+	Serial.print("Density "); Serial.print(id, DEC); Serial.println("K");
+	Serial.print("Size "); Serial.print(mymemory.getMaxAddress(), DEC); Serial.println(" bytes");
+}
+
+void dump(uint16_t addr, uint32_t len) {
+	byte result = ERROR_0;
+	uint32_t offset = 0;
+	uint16_t at;
+	byte i;
+	while ((offset < len) && (result == ERROR_0)) {
+		byte chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		result = mymemory.readBlock(addr + (uint16_t) offset, chunk, buffer);
+		if (result != ERROR_0) break;
+		for (i = 0; i < chunk; i++) {
+			// 16 bytes per line whatever the chunk size
+			if (((offset + i) % 16) == 0) {
+				if ((offset + i) != 0) Serial.println();
+				at = addr + (uint16_t) (offset + i);
+				if (at < 0x1000) Serial.print('0');
+				if (at < 0x100) Serial.print('0');
+				if (at < 0x10) Serial.print('0');
+				Serial.print(at, HEX);
+				Serial.print(':');
+			}
+			Serial.print(buffer[i] < 0x10 ? " 0" : " ");
+			Serial.print(buffer[i], HEX);
+		}
+		offset += chunk;
+	}
+	if (offset != 0) Serial.println();
+	printResult(result);
+}
+
+void save(uint16_t addr, uint32_t len) {
+	// the image ends with its own end record, see FRAM_Image.h, the result line follows it
+	byte result;
+	if (len == 0) result = FRAM_Image::dump(&mymemory, Serial);
+	else result = FRAM_Image::dump(&mymemory, Serial, addr, len);
+	printResult(result);
+}
+
+void load(void) {
+	uint32_t written;
+	byte result = FRAM_Image::restore(&mymemory, Serial, &written);
+	printResult(result);
+	Serial.print("bytes written "); Serial.println(written, DEC);
+}
+
+void verify(uint16_t addr, uint32_t len, uint8_t value) {
+	byte result = ERROR_0;
+	uint32_t offset = 0;
+	uint32_t errors = 0;
+	byte i;
+	while ((offset < len) && (result == ERROR_0)) {
+		byte chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		result = mymemory.readBlock(addr + (uint16_t) offset, chunk, buffer);
+		if (result != ERROR_0) break;
+		for (i = 0; i < chunk; i++) {
+			if (buffer[i] != value) {
+				if (errors == 0) {
+					Serial.print("first mismatch at 0x");
+					Serial.println(addr + (uint16_t) offset + i, HEX);
+				}
+				errors++;
+			}
+		}
+		offset += chunk;
+	}
+	printResult(result);
+	Serial.print("mismatches "); Serial.println(errors, DEC);
+}
+
+void crc(uint16_t addr, uint32_t len) {
+	uint32_t crc;
+	byte result = FRAM_Image::crc32(&mymemory, addr, len, &crc);
+	printResult(result);
+	Serial.print("crc32 0x"); Serial.println(crc, HEX);
+}
+
+void bench(uint16_t addr, uint32_t len) {
+	byte result = ERROR_0;
+	uint32_t offset = 0;
+	uint32_t readTime = 0;
+	uint32_t writeTime = 0;
+	uint32_t start;
+	while ((offset < len) && (result == ERROR_0)) {
+		byte chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		start = micros();
+		result = mymemory.readBlock(addr + (uint16_t) offset, chunk, buffer);
+		readTime += micros() - start;
+		if (result != ERROR_0) break;
+		start = micros();
+		result = mymemory.writeBlock(addr + (uint16_t) offset, chunk, buffer);
+		writeTime += micros() - start;
+		offset += chunk;
+	}
+	printResult(result);
+	if ((readTime == 0) || (writeTime == 0)) return;
+	Serial.print("read  "); Serial.print((offset * 1000UL) / (readTime / 1000UL + 1), DEC); Serial.println(" bytes/s");
+	Serial.print("write "); Serial.print((offset * 1000UL) / (writeTime / 1000UL + 1), DEC); Serial.println(" bytes/s");
+}
+
+void printFault(uint16_t addr, uint8_t expected, uint8_t actual, void *context) {
+	uint16_t *shown = (uint16_t *) context;
+	if ((*shown)++ >= 8) return;
+	Serial.print("fault at 0x"); Serial.print(addr, HEX);
+	Serial.print(" expected 0x"); Serial.print(expected, HEX);
+	Serial.print(" read 0x"); Serial.println(actual, HEX);
+}
+
+void selfTest(uint16_t addr, uint32_t len, boolean keep) {
+	FRAM_SelfTestReport report;
+	uint16_t shown = 0;
+	report.handler = printFault;
+	report.context = &shown;
+	byte result = FRAM_SelfTest::addressTest(&mymemory, addr, len, &report);
+	uint32_t faults = report.faults;
+	if ((result == ERROR_0) || (result == ERROR_12)) result = FRAM_SelfTest::marchC(&mymemory, addr, len, keep, &report);
+	printResult(result);
+	Serial.print("faults "); Serial.println(faults + report.faults, DEC);
+	Serial.print("march "); Serial.print(FRAM_SelfTest::throughput(&report), DEC); Serial.println(" bytes/s");
+}
+
+void rawRead(uint16_t addr, uint32_t len, byte result) {
+	uint32_t offset = 0;
+	while (offset < len) {
+		byte chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		// the host expects len bytes whatever happens, the status byte tells if they are valid
+		if (result == ERROR_0) result = mymemory.readBlock(addr + (uint16_t) offset, chunk, buffer);
+		if (result != ERROR_0) memset(buffer, 0, chunk);
+		Serial.write(buffer, chunk);
+		offset += chunk;
+	}
+	Serial.write(result);
+}
+
+void rawWrite(uint16_t addr, uint32_t len, byte result) {
+	uint32_t offset = 0;
+	while (offset < len) {
+		byte chunk = ((len - offset) > FRAM_CHUNK_SIZE) ? FRAM_CHUNK_SIZE : (byte) (len - offset);
+		if (Serial.readBytes(buffer, chunk) != chunk) {
+			result = ERROR_12;
+			break;
+		}
+		if (result == ERROR_0) result = mymemory.writeBlock(addr + (uint16_t) offset, chunk, buffer);
+		offset += chunk;
+	}
+	Serial.write(result);
+}
+
+void sync(boolean toHost, uint16_t addr, uint32_t len, uint16_t block, byte result) {
+	uint16_t blocks;
+	// the result reaches the host through the protocol: 'E' and the status byte
+	// instead of the header, or the status bytes of the session, see FRAM_Sync.h
+	if (result != ERROR_0) {
+		Serial.write((uint8_t) FRAM_SYNC_ERROR);
+		Serial.write(result);
+	}
+	else if (toHost) FRAM_Sync::sendChanges(&mymemory, Serial, addr, len, block, &blocks);
+	else FRAM_Sync::receiveChanges(&mymemory, Serial, addr, len, block, &blocks);
+}
@@ -0,0 +1,259 @@
+"""Host side access to FRAM chips for test and analytics scripts.
+
+SerialFram talks to a board running the FRAM_I2C_tool example and moves data
+with its binary `read` / `write` commands. Reads land straight in the caller's
+buffer (bytearray, memoryview, numpy array...) through Serial.readinto(), the
+GIL is released by pyserial while waiting for the bus.
+
+SimFram maps the image file of a simulated chip (FRAM_MB85RC_I2C::mapImageFile)
+and gives zero-copy views of it, eg. numpy.frombuffer(sim.view(0, 1024)).
+
+find() / find_all() search dumps for markers with the optimized substring
+search of bytes / mmap, the host counterpart of FRAM_Search.
+
+sync_from_chip() / sync_to_chip() are the host side of the FRAM_Sync protocol
+described in FRAM_Sync.h: only the blocks whose Adler-32 / CRC32 signatures
+differ between the chip and a host image cross the link. SerialFram.backup()
+and SerialFram.update() run them through the tool `syncout` / `syncin`
+commands. The image is any writable buffer indexed by chip address, eg. a
+bytearray of the chip size or SimFram.view(0, size).
+
+Requires pyserial for SerialFram.
+"""
+
+import mmap
+import os
+import struct
+import zlib
+
+SYNC_HEADER_SIZE = 12
+SYNC_SIGNATURE_SIZE = 8
+SYNC_SAME = ord("S")
+SYNC_DIFF = ord("D")
+SYNC_ERROR = ord("E")
+
+
+class FramError(Exception):
+    """Non zero status code returned by the library, see README Errors."""
+
+    def __init__(self, code):
+        Exception.__init__(self, "FRAM error %d" % code)
+        self.code = code
+
+
+
+def block_signature(data):
+    """Adler-32 then CRC32 of a block, little endian, as
+    FRAM_Sync::blockSignature()."""
+    return struct.pack("<II", zlib.adler32(data) & 0xFFFFFFFF, zlib.crc32(data) & 0xFFFFFFFF)
+
+
+def _read_exact(link, length):
+    data = bytearray()
+    while len(data) < length:
+        part = link.read(length - len(data))
+        if not part:
+            raise IOError("timeout after %d bytes" % len(data))
+        data += part
+    return data
+
+
+def _read_status(link):
+    status = _read_exact(link, 1)[0]
+    if status != 0:
+        raise FramError(status)
+
+
+def _sync_header(link, image):
+    header = _read_exact(link, 1)
+    if header[0] == SYNC_ERROR:
+        _read_status(link)
+    header += _read_exact(link, SYNC_HEADER_SIZE - 1)
+    if header[0:4] != b"FRSY":
+        raise FramError(12)
+    addr, length, block = struct.unpack("<HIH", bytes(header[4:]))
+    if addr + length > len(image):
+        raise FramError(11)
+    return addr, length, block
+
+
+def sync_from_chip(link, image):
+    """Peer of FRAM_Sync::sendChanges(): sends the signature of each block
+    of the image and copies the blocks the chip answers with. Returns the
+    number of blocks received."""
+    image = memoryview(image).cast("B")
+    addr, length, block = _sync_header(link, image)
+    received = 0
+    for offset in range(0, length, block):
+        area = image[addr + offset:addr + min(offset + block, length)]
+        link.write(block_signature(area))
+        answer = _read_exact(link, 1)[0]
+        if answer == SYNC_SAME:
+            continue
+        if answer == SYNC_ERROR:
+            _read_status(link)
+        if answer != SYNC_DIFF:
+            raise FramError(12)
+        data = _read_exact(link, len(area))
+        _read_status(link)
+        area[:] = data
+        received += 1
+    return received
+
+
+def sync_to_chip(link, image):
+    """Peer of FRAM_Sync::receiveChanges(): compares the signature of each
+    chip block with the image and sends the blocks which differ. Returns
+    the number of blocks sent."""
+    image = memoryview(image).cast("B")
+    addr, length, block = _sync_header(link, image)
+    sent = 0
+    for offset in range(0, length, block):
+        _read_status(link)
+        area = image[addr + offset:addr + min(offset + block, length)]
+        if _read_exact(link, SYNC_SIGNATURE_SIZE) == block_signature(area):
+            link.write(bytes([SYNC_SAME]))
+        else:
+            link.write(bytes([SYNC_DIFF]))
+            link.write(area)
+            sent += 1
+    # status of the last block written
+    _read_status(link)
+    return sent
+
+
+class SerialFram(object):
+    """Chip behind a board running the FRAM_I2C_tool sketch."""
+
+    def __init__(self, port, baudrate=115200, timeout=5):
+        import serial
+        self.link = serial.Serial(port, baudrate, timeout=timeout)
+        self.link.reset_input_buffer()
+
+    def close(self):
+        self.link.close()
+
+    def readinto(self, addr, buf):
+        """Reads len(buf) bytes at addr directly into a writable buffer."""
+        view = memoryview(buf).cast("B")
+        self.link.write(b"read %d %d\n" % (addr, len(view)))
+        done = 0
+        while done < len(view):
+            n = self.link.readinto(view[done:])
+            if not n:
+                raise IOError("timeout after %d bytes" % done)
+            done += n
+        self._status()
+        return done
+
+    def read(self, addr, length):
+        buf = bytearray(length)
+        self.readinto(addr, buf)
+        return buf
+
+    def write(self, addr, data):
+        """Writes any buffer protocol object at addr."""
+        view = memoryview(data).cast("B")
+        self.link.write(b"write %d %d\n" % (addr, len(view)))
+        self.link.write(view)
+        self._status()
+
+    def find(self, pattern, start=0, end=None, chunk=4096):
+        """Address of the first match in [start, end), -1 if none."""
+        for addr in self.find_all(pattern, start, end, chunk):
+            return addr
+        return -1
+
+    def find_all(self, pattern, start=0, end=None, chunk=4096):
+        """Yields the addresses of all matches, reading chunks which overlap
+        by len(pattern) - 1 bytes. end is required for a serial chip."""
+        if end is None:
+            raise ValueError("end address required")
+        keep = len(pattern) - 1
+        window = bytearray()
+        base = start
+        addr = start
+        while addr < end:
+            n = min(chunk, end - addr)
+            window += self.read(addr, n)
+            addr += n
+            pos = window.find(pattern)
+            while pos >= 0:
+                yield base + pos
+                pos = window.find(pattern, pos + 1)
+            drop = max(len(window) - keep, 0)
+            del window[:drop]
+            base += drop
+
+    def backup(self, image, addr, length, block=256):
+        """Updates the image with the blocks of [addr, addr + length) which
+        differ on the chip. Returns the number of blocks received."""
+        self.link.write(b"syncout %d %d %d\n" % (addr, length, block))
+        return sync_from_chip(self.link, image)
+
+    def update(self, image, addr, length, block=256):
+        """Writes to the chip the blocks of [addr, addr + length) of the
+        image which differ. Returns the number of blocks sent."""
+        self.link.write(b"syncin %d %d %d\n" % (addr, length, block))
+        return sync_to_chip(self.link, image)
+
+    def _status(self):
+        status = self.link.read(1)
+        if len(status) != 1:
+            raise IOError("no status byte")
+        if status[0] != 0:
+            raise FramError(status[0])
+
+
+class SimFram(object):
+    """Simulated chip image file, shared with mapImageFile() on the same host."""
+
+    def __init__(self, path, size, offset=0):
+        self.size = size
+        fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o644)
+        try:
+            if os.fstat(fd).st_size < offset + size:
+                os.ftruncate(fd, offset + size)
+            # mmap offsets must be aligned on the allocation granularity
+            pad = offset % mmap.ALLOCATIONGRANULARITY
+            self._map = mmap.mmap(fd, size + pad, offset=offset - pad)
+        finally:
+            os.close(fd)
+        self._pad = pad
+        self._view = memoryview(self._map)[pad:pad + size]
+
+    def close(self):
+        self._view.release()
+        self._map.close()
+
+    def view(self, addr, length):
+        """Zero-copy view of a memory area, writable."""
+        if addr < 0 or addr + length > self.size:
+            raise FramError(11)
+        return self._view[addr:addr + length]
+
+    def find(self, pattern, start=0, end=None):
+        """Address of the first match in [start, end), -1 if none."""
+        if end is None:
+            end = self.size
+        pos = self._map.find(pattern, self._pad + start, self._pad + end)
+        return pos - self._pad if pos >= 0 else -1
+
+    def find_all(self, pattern, start=0, end=None):
+        """Yields the addresses of all matches in [start, end)."""
+        addr = self.find(pattern, start, end)
+        while addr >= 0:
+            yield addr
+            addr = self.find(pattern, addr + 1, end)
+
+    def readinto(self, addr, buf):
+        view = memoryview(buf).cast("B")
+        view[:] = self.view(addr, len(view))
+        return len(view)
+
+    def read(self, addr, length):
+        return bytearray(self.view(addr, length))
+
+    def write(self, addr, data):
+        view = memoryview(data).cast("B")
+        self.view(addr, len(view))[:] = view
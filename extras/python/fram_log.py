@@ -0,0 +1,160 @@
+"""Host decoder of the deferred formatting log written by FRAM_Log.
+
+The chip only holds format identifiers and raw argument bytes. The format
+table is rebuilt from the sources of the build: every FRAM_LOG(logger,
+"format", ...) call is found and its format string hashed like
+FRAM_Log::formatId(). The log area is read through SerialFram or SimFram,
+see fram.py, and each record is expanded with its printf-like format.
+
+    python fram_log.py --port /dev/ttyACM0 --addr 1024 --size 4096 sketch/
+    python fram_log.py --image chip.img --chip-size 32768 --addr 1024 --size 4096 sketch/
+"""
+
+import argparse
+import codecs
+import os
+import re
+import struct
+import sys
+
+from fram import FramError, SerialFram, SimFram
+
+HEADER_SIZE = 6
+ID_SIZE = 4
+END = 0x00
+WRAP = 0xFF
+
+SOURCES = (".ino", ".pde", ".c", ".cpp", ".h", ".hpp")
+CALL = re.compile(r'FRAM_LOG\s*\(\s*[^,()]+,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"')
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l)?([diouxXcsfFeEgG%])")
+
+
+def format_id(fmt):
+    """32-bit FNV-1a hash of the format bytes, as FRAM_Log::formatId()."""
+    h = 2166136261
+    for c in bytearray(fmt):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def format_table(paths):
+    """Maps format identifiers to format strings found in source files or
+    directories. Adjacent string literals are joined like the compiler does."""
+    table = {}
+    for path in paths:
+        if os.path.isdir(path):
+            files = [os.path.join(d, f) for d, _, names in os.walk(path)
+                     for f in names if f.endswith(SOURCES)]
+        else:
+            files = [path]
+        for name in files:
+            with open(name, "rb") as src:
+                text = src.read().decode("latin-1")
+            for call in CALL.finditer(text):
+                fmt = b"".join(codecs.escape_decode(lit.encode("latin-1"))[0]
+                               for lit in LITERAL.findall(call.group(1)))
+                fid = format_id(fmt)
+                if table.get(fid, fmt) != fmt:
+                    raise ValueError("format id collision 0x%08x: %r / %r" % (fid, table[fid], fmt))
+                table[fid] = fmt
+    return table
+
+
+def read_records(fram, addr, size):
+    """Yields (format id, argument bytes) from the oldest record. Returns
+    the int and long sizes of the writer in the first tuple."""
+    area = fram.read(addr, size)
+    if area[0:2] != b"DL":
+        raise FramError(12)
+    int_size, long_size = area[2], area[3]
+    data = area[HEADER_SIZE:]
+    offset = area[4] | (area[5] << 8)
+    yield int_size, long_size
+    for _ in range(len(data)):
+        if offset >= len(data):
+            raise FramError(12)
+        length = data[offset]
+        if length == END:
+            return
+        if length == WRAP:
+            offset = 0
+            continue
+        record = data[offset:offset + length]
+        fid = struct.unpack_from("<I", record, 1)[0]
+        yield fid, bytes(record[1 + ID_SIZE:])
+        offset += length
+    raise FramError(12)
+
+
+def expand(fmt, args, int_size, long_size):
+    """Applies a printf-like format to the packed arguments: char and short
+    were stored as int, float and double as float, strings with a length."""
+    fmt = fmt.decode("latin-1")
+    out = []
+    pos = 0
+    last = 0
+    for spec in SPEC.finditer(fmt):
+        out.append(fmt[last:spec.start()])
+        last = spec.end()
+        flags, length, conv = spec.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if conv == "s":
+            n = args[pos]
+            value = args[pos + 1:pos + 1 + n].decode("latin-1")
+            pos += 1 + n
+        elif conv in "fFeEgG":
+            value = struct.unpack_from("<f", args, pos)[0]
+            pos += 4
+        else:
+            width = {"l": long_size, "ll": 8}.get(length, int_size)
+            if len(args) < pos + width:
+                raise ValueError("record too short")
+            value = int.from_bytes(args[pos:pos + width], "little", signed=conv in "dic")
+            pos += width
+            if conv == "c":
+                value = chr(value & 0xFF)
+            conv = "d" if conv == "u" else conv
+        out.append(("%" + flags + conv) % value)
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode_log(fram, addr, size, table):
+    """Yields the text of the records, oldest first."""
+    records = read_records(fram, addr, size)
+    int_size, long_size = next(records)
+    for fid, args in records:
+        fmt = table.get(fid)
+        if fmt is None:
+            yield "<unknown format 0x%08x> %s" % (fid, args.hex())
+            continue
+        try:
+            yield expand(fmt, args, int_size, long_size)
+        except (ValueError, IndexError, struct.error):
+            yield "<bad arguments for %r> %s" % (fmt, args.hex())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("sources", nargs="+", help="sketch sources or directories")
+    parser.add_argument("--addr", type=int, required=True, help="log area address")
+    parser.add_argument("--size", type=int, required=True, help="log area size")
+    parser.add_argument("--port", help="serial port of a board running FRAM_I2C_tool")
+    parser.add_argument("--image", help="image file of a simulated chip")
+    parser.add_argument("--chip-size", type=int, default=65536, help="simulated chip size")
+    opts = parser.parse_args()
+
+    table = format_table(opts.sources)
+    fram = SerialFram(opts.port) if opts.port else SimFram(opts.image, opts.chip_size)
+    try:
+        for line in decode_log(fram, opts.addr, opts.size, table):
+            print(line)
+    finally:
+        fram.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())